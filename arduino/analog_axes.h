@@ -0,0 +1,199 @@
+/* USB HID Multiplayer Joystick */
+/* Author: Matthew Nikkanen
+ * Released into public domain.
+ */
+
+/*
+ * Analog stick axes, read by the Mega 2560's ADC under interrupt.
+ *
+ * Each player's X and Y potentiometers are wired to a pair of analog pins:
+ * player 1 on A0 and A1, player 2 on A2 and A3, and so on. The ADC runs
+ * continuously in the background: every conversion-complete interrupt
+ * stores its result and starts the next conversion, so the scan never
+ * waits on analogRead(). Each channel is converted ANALOG_OVERSAMPLE times
+ * in a row and the results summed, then the sweep moves to the next
+ * channel. The summed readings are published for the whole sweep, and
+ * picked up by the scan whenever a new sweep has completed.
+ *
+ * At an ADC clock of F_CPU / 32 a conversion takes 26 microseconds, so
+ * with four-fold oversampling a sweep of eight channels completes about
+ * every 0.8 ms, and of sixteen about every 1.7 ms.
+ *
+ * Readings are calibrated before scaling to the report's 8-bit axis range:
+ * the centre is taken from the first sweep, so the sticks must be at rest
+ * at power-up, and each end of an axis' travel is learned as the stick
+ * reaches it. Movement within ANALOG_DEADZONE of the centre reads as
+ * centred.
+ */
+
+#ifndef _ANALOG_AXES_H_
+#define _ANALOG_AXES_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#include "players.h"
+#include "serial_link.h"
+
+/** Two channels per player, X then Y. */
+#define ANALOG_CHANNELS         (PLAYER_NUM * 2)
+
+#if defined(PORT_SCAN_PLAYER_NUM) && (PORT_SCAN_PLAYER_NUM > 4)
+#error "A0 to A7 carry the fifth player's switches; use INPUT_SHIFT_REGISTERS"
+#endif
+
+/** Conversions summed per reading; the full scale grows to match. */
+#define ANALOG_OVERSAMPLE       4
+#define ANALOG_FULL_SCALE       (1023 * ANALOG_OVERSAMPLE)
+
+/** Half-width of the centre deadzone, in summed reading steps. */
+#ifndef ANALOG_DEADZONE
+#define ANALOG_DEADZONE         64
+#endif
+
+/** Travel assumed either side of centre until the stick has been moved. */
+#define ANALOG_TRAVEL_MIN       (ANALOG_FULL_SCALE / 4)
+
+/** Report axis range. */
+#define ANALOG_AXIS_MAX         LINK_AXIS_MAX
+#define ANALOG_AXIS_CENTRE      ((LINK_AXIS_MAX + 1) / 2)
+
+/** ADC clock prescaler bits: F_CPU / 32, 500 kHz at 16 MHz. */
+#define ANALOG_ADC_PRESCALE     ((1 << ADPS2) | (1 << ADPS0))
+
+typedef struct analog_adc_t_ {
+  volatile uint16_t value[ANALOG_CHANNELS]; /* Summed readings, published */
+  volatile uint8_t  sweeps;                 /* Completed sweeps, wrapping */
+  uint16_t          sum;                    /* Sum for the current channel */
+  uint8_t           channel;
+  uint8_t           samples;
+} analog_adc_t;
+
+typedef struct analog_cal_t_ {
+  uint16_t min;
+  uint16_t centre;
+  uint16_t max;
+  uint32_t lo_scale;  /* Output steps per reading step, 16.16 fixed point */
+  uint32_t hi_scale;
+} analog_cal_t;
+
+/*
+ * ADC.
+ */
+
+/* Route a channel to the ADC, referenced to AVcc. */
+static inline void analog_adc_select(uint8_t channel)
+{
+  ADMUX  = (1 << REFS0) | (channel & 0x07);
+  ADCSRB = (channel & 0x08) ? (1 << MUX5) : 0;
+}
+
+/*
+ * Start the background conversions. The analog pins' digital input
+ * buffers are turned off, as they would only draw current.
+ */
+static inline void analog_adc_start(analog_adc_t *adc)
+{
+  memset((void *)adc, 0, sizeof(*adc));
+
+  DIDR0 = (uint8_t)((1UL << ANALOG_CHANNELS) - 1);
+  DIDR2 = (uint8_t)(((1UL << ANALOG_CHANNELS) - 1) >> 8);
+
+  analog_adc_select(0);
+  ADCSRA = (1 << ADEN) | (1 << ADIE) | (1 << ADSC) | ANALOG_ADC_PRESCALE;
+}
+
+/*
+ * Conversion complete: called from ADC_vect with the result. A new
+ * channel only affects conversions started after it is selected, so the
+ * next channel is selected before the next conversion is started.
+ */
+static inline void analog_adc_complete(analog_adc_t *adc, uint16_t sample)
+{
+  adc->sum += sample;
+
+  if (++adc->samples == ANALOG_OVERSAMPLE) {
+    adc->value[adc->channel] = adc->sum;
+    adc->sum = 0;
+    adc->samples = 0;
+
+    if (++adc->channel == ANALOG_CHANNELS) {
+      adc->channel = 0;
+      adc->sweeps++;
+    }
+    analog_adc_select(adc->channel);
+  }
+
+  ADCSRA |= (1 << ADSC);
+}
+
+/* Copy out the latest readings; they are 16 bits, so interrupts are held. */
+static inline void analog_adc_read(analog_adc_t *adc,
+                                   uint16_t value[ANALOG_CHANNELS])
+{
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    memcpy(value, (const void *)adc->value, sizeof(adc->value));
+  }
+}
+
+/*
+ * Calibration and scaling.
+ */
+
+/* Recompute the scale factors after the centre or an end has moved. */
+static inline void analog_cal_update(analog_cal_t *cal)
+{
+  int32_t lo_travel = (int32_t)cal->centre - ANALOG_DEADZONE - cal->min;
+  int32_t hi_travel = (int32_t)cal->max - ANALOG_DEADZONE - cal->centre;
+
+  cal->lo_scale = (lo_travel > 0) ?
+    ((uint32_t)ANALOG_AXIS_CENTRE << 16) / (uint32_t)lo_travel : 0;
+  cal->hi_scale = (hi_travel > 0) ?
+    ((uint32_t)(ANALOG_AXIS_MAX - ANALOG_AXIS_CENTRE) << 16) /
+    (uint32_t)hi_travel : 0;
+}
+
+static inline void analog_cal_init(analog_cal_t *cal, uint16_t centre)
+{
+  cal->centre = centre;
+  cal->min = (centre > ANALOG_TRAVEL_MIN) ? centre - ANALOG_TRAVEL_MIN : 0;
+  cal->max = (centre < ANALOG_FULL_SCALE - ANALOG_TRAVEL_MIN) ?
+             centre + ANALOG_TRAVEL_MIN : ANALOG_FULL_SCALE;
+  analog_cal_update(cal);
+}
+
+/*
+ * Scale a reading to the report's axis range, widening the calibrated
+ * travel if the reading is beyond it. The division is only done when the
+ * travel changes; otherwise scaling is a multiply per axis, rounded so
+ * the ends of the travel reach the ends of the range.
+ */
+static inline uint8_t analog_axis_scale(analog_cal_t *cal, uint16_t reading)
+{
+  int32_t offset = (int32_t)reading - cal->centre;
+
+  if ((reading < cal->min) || (reading > cal->max)) {
+    if (reading < cal->min) {
+      cal->min = reading;
+    } else {
+      cal->max = reading;
+    }
+    analog_cal_update(cal);
+  }
+
+  if (offset > ANALOG_DEADZONE) {
+    return ANALOG_AXIS_CENTRE +
+      (uint8_t)(((uint32_t)(offset - ANALOG_DEADZONE) * cal->hi_scale +
+                 0x8000) >> 16);
+  }
+  if (offset < -ANALOG_DEADZONE) {
+    return ANALOG_AXIS_CENTRE -
+      (uint8_t)(((uint32_t)(-offset - ANALOG_DEADZONE) * cal->lo_scale +
+                 0x8000) >> 16);
+  }
+  return ANALOG_AXIS_CENTRE;
+}
+
+#endif /* _ANALOG_AXES_H_ */
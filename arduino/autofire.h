@@ -0,0 +1,144 @@
+/* USB HID Multiplayer Joystick */
+/* Author: Matthew Nikkanen
+ * Released into public domain.
+ */
+
+/*
+ * Autofire, timed by the scan timer.
+ *
+ * While an autofire button is held, it reads as pressed and released in
+ * turn, each phase lasting a set number of report periods. Phases only
+ * change on report period boundaries, counted in scan ticks from the
+ * hardware timer, so the toggles are locked to a fixed grid rather than to
+ * when loop() happens to run. A phase is never shorter than a report
+ * period, so the sketch sends every toggle on the link, and the host sees
+ * every one of them rather than only the last state of a period.
+ *
+ * A press starts with the pressed phase at once; any part of a period
+ * before the next boundary is added to it, so it is never cut short.
+ * Releasing the button ends autofire at once.
+ */
+
+#ifndef _AUTOFIRE_H_
+#define _AUTOFIRE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include "players.h"
+
+/** Autofire buttons configured with a rate. */
+#ifndef AUTOFIRE
+#define AUTOFIRE                0
+#endif
+
+/**
+ * Report period, in milliseconds: the USB polling interval (see
+ * descriptors.h), so 1 with the firmware's LOW_LATENCY_MODE.
+ */
+#ifndef AUTOFIRE_REPORT_MS
+#define AUTOFIRE_REPORT_MS      2
+#endif
+
+/** Buttons in bits 4 to 11 of the input word (see port_scan.h). */
+#define AUTOFIRE_BUTTONS        8
+#define AUTOFIRE_BUTTON_SHIFT   4
+
+/**
+ * Autofire rate of each player's buttons, in presses per second, 0 for
+ * none. May be overridden at build time, as an expression of the player
+ * and button index. By default the six game buttons fire at 15 Hz, and the
+ * player and shift buttons do not autofire.
+ */
+#ifndef AUTOFIRE_RATE_HZ
+#define AUTOFIRE_RATE_HZ(player, button)    (((button) < 6) ? 15 : 0)
+#endif
+
+/** Report periods per phase for a rate, rounded, at least one. */
+#define AUTOFIRE_PERIODS(hz)                                                \
+  (((hz) == 0) ? 0 :                                                        \
+   ((1000 / (2 * (hz) * AUTOFIRE_REPORT_MS)) < 1) ? 1 :                     \
+   ((1000 + (hz) * AUTOFIRE_REPORT_MS) / (2 * (hz) * AUTOFIRE_REPORT_MS)))
+
+typedef struct autofire_t_ {
+  uint8_t periods[PLAYER_NUM][AUTOFIRE_BUTTONS]; /* Per phase, 0 for off */
+  uint8_t count[PLAYER_NUM][AUTOFIRE_BUTTONS];   /* Boundaries to a toggle */
+  uint8_t held[PLAYER_NUM];     /* Buttons held at the last update */
+  uint8_t released[PLAYER_NUM]; /* Held buttons in their released phase */
+  uint8_t ticks;                /* Scan ticks into the report period */
+  uint8_t report_ticks;         /* Scan ticks per report period */
+} autofire_t;
+
+/*
+ * Set up autofire for the given scan rate. A scan period longer than the
+ * report period stands in for it.
+ */
+static inline void autofire_init(autofire_t *af, uint16_t scan_rate_hz)
+{
+  uint16_t report_ticks = (uint32_t)AUTOFIRE_REPORT_MS * scan_rate_hz / 1000;
+  uint8_t player, button;
+
+  memset(af, 0, sizeof(*af));
+  af->report_ticks = (report_ticks > 1) ? (uint8_t)report_ticks : 1;
+  for (player = 0; player < PLAYER_NUM; player++) {
+    for (button = 0; button < AUTOFIRE_BUTTONS; button++) {
+      af->periods[player][button] =
+        AUTOFIRE_PERIODS(AUTOFIRE_RATE_HZ(player, button));
+    }
+  }
+}
+
+/*
+ * Advance autofire by the scan ticks elapsed, given every player's
+ * debounced inputs. Called once per scan pass.
+ */
+static inline void autofire_update(autofire_t *af, uint8_t ticks,
+                                   const uint16_t inputs[PLAYER_NUM])
+{
+  uint8_t boundaries = 0;
+  uint8_t player, button, bit;
+
+  af->ticks += ticks;
+  while (af->ticks >= af->report_ticks) {
+    af->ticks -= af->report_ticks;
+    boundaries++;
+  }
+
+  for (player = 0; player < PLAYER_NUM; player++) {
+    uint8_t held = (uint8_t)(inputs[player] >> AUTOFIRE_BUTTON_SHIFT);
+    uint8_t pressed = held & ~af->held[player];
+    uint8_t *periods = af->periods[player];
+    uint8_t *count = af->count[player];
+
+    af->held[player] = held;
+    af->released[player] &= held;
+
+    for (button = 0, bit = 1; button < AUTOFIRE_BUTTONS; button++, bit <<= 1) {
+      if (!periods[button] || !(held & bit)) {
+        continue;
+      }
+
+      if (pressed & bit) {
+        /* Count whole periods from the next boundary on. */
+        count[button] = periods[button] + (af->ticks ? 1 : 0);
+        continue;
+      }
+
+      if (count[button] > boundaries) {
+        count[button] -= boundaries;
+      } else if (boundaries) {
+        count[button] = periods[button];
+        af->released[player] ^= bit;
+      }
+    }
+  }
+}
+
+/* Apply autofire to a player's inputs. */
+static inline uint16_t autofire_inputs(const autofire_t *af, uint8_t player,
+                                       uint16_t inputs)
+{
+  return inputs & ~((uint16_t)af->released[player] << AUTOFIRE_BUTTON_SHIFT);
+}
+
+#endif /* _AUTOFIRE_H_ */
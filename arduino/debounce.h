@@ -0,0 +1,128 @@
+/* USB HID Multiplayer Joystick */
+/* Author: Matthew Nikkanen
+ * Released into public domain.
+ */
+
+/*
+ * Bit-parallel input debouncing.
+ *
+ * Every input bit has its own counter of consecutive samples that disagree
+ * with its debounced state. The counters are stored "vertically": plane n
+ * holds bit n of all the counters of a word, so a single pass of word-wide
+ * logic updates 16 counters at once, and the cost per scan depends only on
+ * the number of words, not on how many inputs are pressed or bouncing.
+ *
+ * An input changes state once it has disagreed for the configured number
+ * of samples. With eager press, a press is accepted on the first sample
+ * instead, and only the release waits for the input to settle; the bounce
+ * that follows a press is then absorbed by the deferred release.
+ */
+
+#ifndef _DEBOUNCE_H_
+#define _DEBOUNCE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+/** Settle time, in milliseconds. May be overridden at build time. */
+#ifndef DEBOUNCE_MS
+#define DEBOUNCE_MS             5
+#endif
+
+/** Accept presses immediately, deferring only releases. */
+#ifndef DEBOUNCE_EAGER_PRESS
+#define DEBOUNCE_EAGER_PRESS    1
+#endif
+
+/** Counter planes; the settle time is at most (2^planes - 1) samples. */
+#define DEBOUNCE_PLANES         4
+#define DEBOUNCE_SAMPLES_MAX    ((1 << DEBOUNCE_PLANES) - 1)
+
+/** Number of input words debounced together. */
+#define DEBOUNCE_WORDS          INPUT_SCAN_PLAYER_NUM
+
+typedef struct debounce_t_ {
+  uint16_t state[DEBOUNCE_WORDS];                  /* Debounced inputs */
+  uint16_t count[DEBOUNCE_PLANES][DEBOUNCE_WORDS]; /* Vertical counters */
+  uint8_t  samples;     /* Consecutive samples needed for a change */
+  uint16_t eager_mask;  /* All ones when presses are accepted eagerly */
+} debounce_t;
+
+/*
+ * Convert a settle time into a sample count at the given scan rate.
+ */
+static inline uint8_t debounce_samples(uint16_t settle_ms, uint16_t rate_hz)
+{
+  uint32_t samples = ((uint32_t)settle_ms * rate_hz) / 1000;
+
+  if (samples < 1) {
+    samples = 1;
+  } else if (samples > DEBOUNCE_SAMPLES_MAX) {
+    samples = DEBOUNCE_SAMPLES_MAX;
+  }
+  return (uint8_t)samples;
+}
+
+static inline void debounce_init(debounce_t *db, uint8_t samples, bool eager)
+{
+  memset(db, 0, sizeof(*db));
+  db->samples = samples;
+  db->eager_mask = eager ? 0xFFFF : 0;
+}
+
+/*
+ * Change the number of samples needed for a change, keeping the debounced
+ * state. Counters only fire on reaching the count exactly, so they restart:
+ * one already past a lowered count would otherwise have to wrap first.
+ */
+static inline void debounce_set_samples(debounce_t *db, uint8_t samples)
+{
+  if (samples != db->samples) {
+    db->samples = samples;
+    memset(db->count, 0, sizeof(db->count));
+  }
+}
+
+/*
+ * Feed one sample of raw inputs through the debouncer, updating the
+ * debounced state in place.
+ */
+static inline void debounce_update(debounce_t *db,
+                                   const uint16_t raw[DEBOUNCE_WORDS])
+{
+  uint8_t w, p;
+
+  for (w = 0; w < DEBOUNCE_WORDS; w++) {
+    uint16_t delta = raw[w] ^ db->state[w];
+    uint16_t carry = delta;
+    uint16_t done  = delta;
+    uint16_t toggle;
+
+    /*
+     * Increment the counters of inputs that disagree with their state and
+     * clear the rest, then find the counters that reached the target.
+     */
+    for (p = 0; p < DEBOUNCE_PLANES; p++) {
+      uint16_t plane = db->count[p][w];
+
+      plane ^= carry;
+      carry &= ~plane;
+      plane &= delta;
+      db->count[p][w] = plane;
+
+      done &= (db->samples & (1 << p)) ? plane : ~plane;
+    }
+
+    toggle = done | (delta & raw[w] & db->eager_mask);
+
+    /*
+     * Apply the changes and restart the counters of inputs that changed.
+     */
+    db->state[w] ^= toggle;
+    for (p = 0; p < DEBOUNCE_PLANES; p++) {
+      db->count[p][w] &= ~toggle;
+    }
+  }
+}
+
+#endif /* _DEBOUNCE_H_ */
@@ -0,0 +1,79 @@
+/* USB HID Multiplayer Joystick */
+/* Author: Matthew Nikkanen
+ * Released into public domain.
+ */
+
+/*
+ * Press and release latching.
+ *
+ * The joystick state follows the inputs scan by scan, but it only reaches
+ * the link when a report is sent, and reports are held back at times (a
+ * pending rate change). A tap that starts and ends while reports are held
+ * would never be sent.
+ *
+ * So every edge an input makes is latched, one bit per input for presses
+ * and one for releases, until a report shows it. An input with an edge
+ * pending reads as the opposite of its last sent state, whatever it reads
+ * now, so a tap shows as pressed in one report and released in the next.
+ * An input that is pressed and released again before the last edge is
+ * sent has its edges merged: one tap is sent for several.
+ */
+
+#ifndef _INPUT_LATCH_H_
+#define _INPUT_LATCH_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include "players.h"
+
+typedef struct input_latch_t_ {
+  uint16_t held[PLAYER_NUM];     /* Inputs at the last update */
+  uint16_t sent[PLAYER_NUM];     /* Inputs shown by the last report sent */
+  uint16_t pressed[PLAYER_NUM];  /* Presses not yet sent */
+  uint16_t released[PLAYER_NUM]; /* Releases not yet sent */
+} input_latch_t;
+
+static inline void input_latch_init(input_latch_t *latch)
+{
+  memset(latch, 0, sizeof(*latch));
+}
+
+/*
+ * Latch the edges in a player's inputs since the last update, and return
+ * the inputs to report: those last sent, with the pending edges applied.
+ * Called once per scan pass.
+ */
+static inline uint16_t input_latch_update(input_latch_t *latch,
+                                          uint8_t player, uint16_t inputs)
+{
+  uint16_t held = latch->held[player];
+  uint16_t sent = latch->sent[player];
+
+  latch->pressed[player] |= inputs & ~held;
+  latch->released[player] |= held & ~inputs;
+  latch->held[player] = inputs;
+
+  return sent ^ ((~sent & latch->pressed[player]) |
+                 (sent & latch->released[player]));
+}
+
+/*
+ * Record that the inputs last returned for a player have been sent.
+ * Inputs that still differ from those held have an edge left to send.
+ */
+static inline void input_latch_sent(input_latch_t *latch, uint8_t player)
+{
+  uint16_t held = latch->held[player];
+  uint16_t sent = latch->sent[player];
+  uint16_t shown = sent ^ ((~sent & latch->pressed[player]) |
+                           (sent & latch->released[player]));
+
+  latch->pressed[player] &= ~(shown & ~sent);
+  latch->released[player] &= ~(sent & ~shown);
+  latch->pressed[player] |= held & ~shown;
+  latch->released[player] |= shown & ~held;
+  latch->sent[player] = shown;
+}
+
+#endif /* _INPUT_LATCH_H_ */
@@ -0,0 +1,108 @@
+/* USB HID Multiplayer Joystick */
+/* Author: Matthew Nikkanen
+ * Released into public domain.
+ */
+
+/*
+ * Shift-layer input remapping.
+ *
+ * Holding a player's shift button switches that player's other inputs to
+ * an alternate mapping layer, so cabinet functions such as coin can share
+ * the game buttons without key-mapping software on the host. Each layer
+ * maps every input to a set of outputs, in the same bit order as the
+ * inputs (see port_scan.h), so the remapped word is used just as the
+ * debounced one would be.
+ *
+ * The layers are expanded at compile time into tables indexed by a nibble
+ * of the input word. Remapping a player ORs together one entry for each of
+ * the three nibbles, from the layer selected by the shift bit, so it costs
+ * the same few cycles whatever is pressed, with no branches.
+ */
+
+#ifndef _INPUT_REMAP_H_
+#define _INPUT_REMAP_H_
+
+#include <stdint.h>
+
+/** Remap inputs through the shift layers. */
+#ifndef INPUT_REMAP
+#define INPUT_REMAP             0
+#endif
+
+/** Input bits: the four joystick switches, then buttons 1 to 8. */
+#define REMAP_LEFT              0
+#define REMAP_RIGHT             1
+#define REMAP_UP                2
+#define REMAP_DOWN              3
+#define REMAP_BUTTON(n)         (4 + (n))  /* n from 0 */
+#define REMAP_PLAYER            REMAP_BUTTON(6)
+#define REMAP_SHIFT             REMAP_BUTTON(7)
+#define REMAP_INPUTS            12
+
+#define REMAP_BIT(in)           (1U << (in))
+
+/*
+ * Layers: the outputs reported for each input, while shift is released and
+ * while it is held. Either may be overridden at build time, as a constant
+ * expression of the input bit.
+ *
+ * By default, inputs report as themselves, except that shift on its own
+ * reports nothing, and shift with the player button reports the shift
+ * button's output as a coin input.
+ */
+#ifndef REMAP_LAYER_BASE
+#define REMAP_LAYER_BASE(in)    REMAP_BIT(in)
+#endif
+
+#ifndef REMAP_LAYER_SHIFT
+#define REMAP_LAYER_SHIFT(in)                                               \
+  (((in) == REMAP_SHIFT)  ? 0 :                                             \
+   ((in) == REMAP_PLAYER) ? REMAP_BIT(REMAP_SHIFT) : REMAP_BIT(in))
+#endif
+
+/*
+ * Table generation: the outputs of the inputs set in nibble value n, for
+ * the given nibble of the input word.
+ */
+#define REMAP_ENTRY(layer, nibble, n)                                       \
+  (uint16_t)((((n) & 1) ? (layer((nibble) * 4 + 0)) : 0) |                  \
+             (((n) & 2) ? (layer((nibble) * 4 + 1)) : 0) |                  \
+             (((n) & 4) ? (layer((nibble) * 4 + 2)) : 0) |                  \
+             (((n) & 8) ? (layer((nibble) * 4 + 3)) : 0))
+
+#define REMAP_NIBBLE(layer, nibble)                                         \
+  REMAP_ENTRY(layer, nibble, 0),  REMAP_ENTRY(layer, nibble, 1),            \
+  REMAP_ENTRY(layer, nibble, 2),  REMAP_ENTRY(layer, nibble, 3),            \
+  REMAP_ENTRY(layer, nibble, 4),  REMAP_ENTRY(layer, nibble, 5),            \
+  REMAP_ENTRY(layer, nibble, 6),  REMAP_ENTRY(layer, nibble, 7),            \
+  REMAP_ENTRY(layer, nibble, 8),  REMAP_ENTRY(layer, nibble, 9),            \
+  REMAP_ENTRY(layer, nibble, 10), REMAP_ENTRY(layer, nibble, 11),           \
+  REMAP_ENTRY(layer, nibble, 12), REMAP_ENTRY(layer, nibble, 13),           \
+  REMAP_ENTRY(layer, nibble, 14), REMAP_ENTRY(layer, nibble, 15)
+
+#define REMAP_LAYER(layer)                                                  \
+  { REMAP_NIBBLE(layer, 0), REMAP_NIBBLE(layer, 1), REMAP_NIBBLE(layer, 2) }
+
+#define REMAP_NIBBLE_ENTRIES    16
+#define REMAP_LAYER_ENTRIES     (REMAP_NIBBLE_ENTRIES * 3)
+
+/** Layer tables, base then shift: 192 bytes. */
+static const uint16_t remap_table[2][REMAP_LAYER_ENTRIES] = {
+  REMAP_LAYER(REMAP_LAYER_BASE),
+  REMAP_LAYER(REMAP_LAYER_SHIFT),
+};
+
+/*
+ * Remap one player's inputs. The word must only have its 12 input bits
+ * set, as the scan leaves it, so the shift bit alone picks the layer.
+ */
+static inline uint16_t remap_inputs(uint16_t inputs)
+{
+  const uint16_t *table = remap_table[inputs >> REMAP_SHIFT];
+
+  return table[inputs & 0x0F] |
+         table[REMAP_NIBBLE_ENTRIES + ((inputs >> 4) & 0x0F)] |
+         table[(REMAP_NIBBLE_ENTRIES * 2) + (inputs >> 8)];
+}
+
+#endif /* _INPUT_REMAP_H_ */
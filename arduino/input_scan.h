@@ -0,0 +1,64 @@
+/* USB HID Multiplayer Joystick */
+/* Author: Matthew Nikkanen
+ * Released into public domain.
+ */
+
+/*
+ * Input backend selection.
+ *
+ * Player inputs are read either straight from the Mega's GPIO pins
+ * (port_scan.h), or from a chain of 74HC165 shift registers on the SPI
+ * port (shift_scan.h), chosen at build time. Both take a snapshot of all
+ * the inputs at once, then decode it into one word per player with the
+ * same bit order, so the debouncer and everything after it are shared.
+ */
+
+#ifndef _INPUT_SCAN_H_
+#define _INPUT_SCAN_H_
+
+/** Read inputs from shift registers rather than GPIO pins. */
+#ifndef INPUT_SHIFT_REGISTERS
+#define INPUT_SHIFT_REGISTERS   0
+#endif
+
+#if INPUT_SHIFT_REGISTERS
+
+#include "shift_scan.h"
+
+#define INPUT_SCAN_PLAYER_NUM   SHIFT_SCAN_PLAYER_NUM
+
+typedef shift_snapshot_t input_snapshot_t;
+
+static inline void input_snapshot_sample(input_snapshot_t *snap)
+{
+  shift_snapshot_sample(snap);
+}
+
+static inline void input_snapshot_decode(const input_snapshot_t *snap,
+                                         uint16_t inputs[INPUT_SCAN_PLAYER_NUM])
+{
+  shift_snapshot_decode(snap, inputs);
+}
+
+#else
+
+#include "port_scan.h"
+
+#define INPUT_SCAN_PLAYER_NUM   PORT_SCAN_PLAYER_NUM
+
+typedef port_snapshot_t input_snapshot_t;
+
+static inline void input_snapshot_sample(input_snapshot_t *snap)
+{
+  port_snapshot_sample(snap);
+}
+
+static inline void input_snapshot_decode(const input_snapshot_t *snap,
+                                         uint16_t inputs[INPUT_SCAN_PLAYER_NUM])
+{
+  port_snapshot_decode(snap, inputs);
+}
+
+#endif /* INPUT_SHIFT_REGISTERS */
+
+#endif /* _INPUT_SCAN_H_ */
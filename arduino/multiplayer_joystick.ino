@@ -3,13 +3,88 @@
  * Released into public domain.
  */
 
+#include "players.h"
+#include "input_scan.h"
+#include "scan_timer.h"
+#include "debounce.h"
+#include "input_remap.h"
+#include "autofire.h"
+#include "input_latch.h"
+#include "serial_link.h"
+#if ANALOG_AXES
+#include "analog_axes.h"
+#endif
+
 bool debug = false;
 
 /*
- * Serial Synchronization
+ * Serial link framing (see serial_link.h).
+ */
+uint8_t link_tx_seq;
+uint8_t link_tx_buffer[LINK_ENCODED_MAX];
+
+/*
+ * Delta mode: only players whose state changed are sent, each tagged with
+ * its player index. A full state frame still goes out every
+ * LINK_KEYFRAME_MS, so a dropped delta frame is corrected promptly.
  */
-uint8_t sync_seq[3] = { 0xFF, 0xFF, 0xFF };
-uint64_t last_sync_timestamp;
+#ifndef LINK_DELTA_MODE
+#define LINK_DELTA_MODE     1
+#endif
+#define LINK_KEYFRAME_MS    500
+
+bool link_delta_mode = LINK_DELTA_MODE;
+uint16_t keyframe_ticks;
+
+/*
+ * Runtime settings, held by the 16U2 (see serial_link.h). They are asked
+ * for every LINK_RETRY_MS until they arrive; until then, and for any left
+ * at their default, the build-time values are used.
+ */
+bool link_settings_received;
+uint16_t link_settings_wait;  /* Ticks until the next request */
+
+/*
+ * Link rate negotiation (see serial_link.h). The link starts at the safe
+ * rate and asks the 16U2 for LINK_RATE_TARGET. Debug output always stays
+ * at the safe rate.
+ *
+ * A rate that loses the 16U2's heartbeat within LINK_PROBATION_MS of being
+ * reached is taken to be too fast for the wiring, and the next rate down
+ * is tried. Losing it later, or hearing nothing even at the safe rate,
+ * means the 16U2 went away (a reset, say) rather than the rate failing, so
+ * the target is tried again once it is back.
+ */
+#ifndef LINK_RATE_TARGET
+#define LINK_RATE_TARGET    LINK_RATE_1M
+#endif
+#define LINK_RETRY_MS       100
+#define LINK_PROBATION_MS   1000
+
+typedef enum link_state_e_ {
+  LINK_STATE_SAFE = 0,  /* At the safe rate, negotiating when due */
+  LINK_STATE_REQUESTED, /* Rate requested, waiting for the 16U2's ACK */
+  LINK_STATE_FAST,      /* At the negotiated rate */
+} link_state_e;
+
+link_decoder_t link_rx_decoder;
+uint8_t link_state = LINK_STATE_SAFE;
+uint8_t link_rate = LINK_RATE_SAFE;
+uint8_t link_rate_target = LINK_RATE_TARGET;
+uint8_t link_rate_limit = LINK_RATE_TARGET; /* Target, less failed rates */
+uint8_t link_peer_rate = LINK_RATE_SAFE; /* Last rate reported by the 16U2 */
+uint16_t link_state_ticks;
+uint16_t link_fast_ticks;   /* Since the rate was reached, up to probation */
+uint16_t link_peer_ticks;   /* Since the last STATUS frame, up to timeout */
+
+/*
+ * Scan scheduling, driven by Timer1 (see scan_timer.h). The counter is 8
+ * bits wide so loop() can read it without disabling interrupts.
+ */
+volatile uint8_t scan_ticks;
+uint8_t scan_ticks_done;
+uint16_t missed_deadlines;
+uint16_t scan_rate_hz = SCAN_RATE_HZ;
 
 
 #define PIN_FIRST           2
@@ -19,13 +94,21 @@ uint64_t last_sync_timestamp;
 #define JOY_CENTRE          50
 #define JOY_RIGHT_DOWN      100
 
+#if (PIN_FIRST != 2) || (PINS_PER_JOYSTICK != 12)
+#error "port_scan.h pin map assumes 12 pins per joystick from pin 2"
+#endif
+
+#if !ANALOG_AXES && (JOY_RIGHT_DOWN != LINK_AXIS_MAX)
+#error "Switch axis range does not match the link's axis range"
+#endif
+
+/*
+ * One joystick per player. The USB firmware maps players onto its
+ * interfaces (see players.h).
+ */
 typedef enum interface_id_e_ {
   IF_FIRST = 0,
-  IF_0     = IF_FIRST,
-  IF_1,
-  IF_2,
-  IF_3,
-  IF_NUM,
+  IF_NUM   = PLAYER_NUM,
 } interface_id_e;
 
 typedef enum joy_e_ {
@@ -45,6 +128,10 @@ typedef enum axis_e_ {
   AXIS_NUM,
 } axis_e;
 
+/*
+ * Buttons. With INPUT_REMAP, the shift button selects the alternate
+ * mapping layer (see input_remap.h).
+ */
 typedef enum button_e_ {
   BUTTON_FIRST  = 0,
   BUTTON_LAST   = 5,
@@ -53,10 +140,20 @@ typedef enum button_e_ {
   BUTTON_NUM,
 } button_e;
 
+#if COMPACT_REPORT
 typedef struct joystick_state_t_ {
-  int8_t axis[AXIS_NUM]; /* Array of joystick axes */
+  uint16_t hat_buttons;  /* Hat in bits 0-3, buttons in bits 4-11 */
+} joystick_state_t;
+#else
+typedef struct joystick_state_t_ {
+  uint8_t axis[AXIS_NUM]; /* Array of joystick axes */
   uint8_t buttons;       /* Bit mask of the currently pressed buttons */
 } joystick_state_t;
+#endif
+
+#if (PLAYER_NUM * LINK_DELTA_RECORD_SIZE) > LINK_PAYLOAD_MAX
+#error "Link payload too small for a delta frame of all players"
+#endif
 
 /*
  * State: recorded and previously sent.
@@ -64,6 +161,67 @@ typedef struct joystick_state_t_ {
 joystick_state_t joy_state[IF_NUM];
 joystick_state_t prev_joy_state[IF_NUM];
 
+/*
+ * Raw inputs from the last scan, one word per joystick (see input_scan.h).
+ */
+input_snapshot_t input_snapshot;
+uint16_t joy_inputs[INPUT_SCAN_PLAYER_NUM];
+
+/*
+ * Debounced inputs (see debounce.h).
+ */
+debounce_t debounce;
+
+#if AUTOFIRE
+/*
+ * Autofire phases (see autofire.h).
+ */
+autofire_t autofire;
+#endif
+
+/*
+ * Edges not yet sent (see input_latch.h).
+ */
+input_latch_t input_latch;
+
+#if ANALOG_AXES
+/*
+ * Analog axes (see analog_axes.h): background readings, the sweep they
+ * were last picked up from, and each axis' calibration and scaled value.
+ * Calibration starts with the first complete sweep.
+ */
+analog_adc_t analog_adc;
+uint8_t analog_sweeps_done;
+bool analog_calibrated;
+analog_cal_t analog_cal[ANALOG_CHANNELS];
+uint8_t analog_axis[ANALOG_CHANNELS];
+#endif
+
+/*
+ * Axis value for each combination of an axis' two switches, indexed by
+ * (right/down << 1) | left/up. Both activated cancels out.
+ */
+const uint8_t axis_value[4] = {
+  JOY_CENTRE,      /* Centred */
+  JOY_LEFT_UP,     /* Left/Up activated */
+  JOY_RIGHT_DOWN,  /* Right/Down activated */
+  JOY_CENTRE,      /* Both activated; cancel */
+};
+
+#if COMPACT_REPORT
+/*
+ * Hat position for each combination of the four switches, indexed by
+ * (down << 3) | (up << 2) | (right << 1) | left. Positions run clockwise
+ * from 0 (up); opposing switches cancel, as for the axes.
+ */
+const uint8_t hat_value[16] = {
+  LINK_HAT_NONE, 6, 2, LINK_HAT_NONE,  /* -, L, R, LR */
+  0, 7, 1, 0,                          /* U, UL, UR, ULR */
+  4, 5, 3, 4,                          /* D, DL, DR, DLR */
+  LINK_HAT_NONE, 6, 2, LINK_HAT_NONE,  /* UD, UDL, UDR, UDLR */
+};
+#endif
+
 
 /*
  * Setup.
@@ -71,54 +229,88 @@ joystick_state_t prev_joy_state[IF_NUM];
  
 void joystick_setup(int if_ix)
 {
-  int pin_base = PIN_FIRST + if_ix*PINS_PER_JOYSTICK;
+#if !INPUT_SHIFT_REGISTERS || !COMPACT_REPORT
   int ix;
+#endif
 
   /*
-   * Configure pins.
+   * Configure pins. Shift-register inputs are pulled up on their board.
    */
+#if !INPUT_SHIFT_REGISTERS
+  int pin_base = PIN_FIRST + if_ix*PINS_PER_JOYSTICK;
+
   for (ix = 0; ix < PINS_PER_JOYSTICK; ix++) {
     pinMode(pin_base + ix, INPUT);
     digitalWrite(pin_base + ix, HIGH);
   }
+#endif
 
   /*
    * Initialize joystick state.
    */
+#if COMPACT_REPORT
+  joy_state[if_ix].hat_buttons = LINK_HAT_NONE;
+#else
   for (ix = AXIS_FIRST; ix < AXIS_NUM; ix++) {
     joy_state[if_ix].axis[ix] = 0;
   }
   joy_state[if_ix].buttons = 0;
-}
-
-void send_sync()
-{
-  if (!debug) {
-    Serial.write(sync_seq, sizeof(sync_seq));
-  } else {
-    Serial.print(sync_seq[0]);
-    Serial.print(sync_seq[1]);
-    Serial.print(sync_seq[2]);
-  }
-
-  last_sync_timestamp = millis();
+#endif
 }
 
 void setup()
 {
-  uint8_t if_ix, ix;
+  uint8_t if_ix;
+#if ANALOG_AXES
+  uint8_t ix;
+#endif
   
-  Serial.begin(115200);
+  Serial.begin(link_rate_baud[LINK_RATE_SAFE]);
   delay(200);
 
   for (if_ix = IF_FIRST; if_ix < IF_NUM; if_ix++) {
     joystick_setup(if_ix);
   }
+#if INPUT_SHIFT_REGISTERS
+  shift_scan_setup();
+#endif
+
+  link_decoder_init(&link_rx_decoder);
+
+  /* Start at the safe rate with the build-time settings, and ask for the
+   * 16U2's on the first pass.
+   */
+  scan_rate_hz = SCAN_RATE_HZ;
+  link_state = LINK_STATE_SAFE;
+  link_rate = LINK_RATE_SAFE;
+  link_rate_target = LINK_RATE_TARGET;
+  link_rate_limit = LINK_RATE_TARGET;
+  link_peer_ticks = 0;
+  link_delta_mode = LINK_DELTA_MODE;
+  link_settings_received = false;
+  link_settings_wait = 0;
+
+  debounce_init(&debounce, debounce_samples(DEBOUNCE_MS, scan_rate_hz),
+                DEBOUNCE_EAGER_PRESS);
+#if AUTOFIRE
+  autofire_init(&autofire, scan_rate_hz);
+#endif
+  input_latch_init(&input_latch);
+
+#if ANALOG_AXES
+  for (ix = 0; ix < ANALOG_CHANNELS; ix++) {
+    analog_axis[ix] = ANALOG_AXIS_CENTRE;
+  }
+  analog_calibrated = false;
+  analog_adc_start(&analog_adc);
+  analog_sweeps_done = analog_adc.sweeps;
+#endif
 
   /*
-   * Reset serial.
+   * Start the scan timebase.
    */
-  send_sync();
+  scan_ticks_done = scan_ticks;
+  scan_timer_start(scan_rate_hz);
 }
 
 
@@ -126,112 +318,428 @@ void setup()
  * Loop activities.
  */
 
-void button_state(joystick_state_t *joy_state,
-                  uint8_t button,
-                  bool is_pressed)
+ISR(TIMER1_COMPA_vect)
 {
-  if (is_pressed) {
-    joy_state->buttons |= (1 << button);
+  scan_ticks++;
+}
+
+#if ANALOG_AXES
+ISR(ADC_vect)
+{
+  analog_adc_complete(&analog_adc, ADC);
+}
+
+/*
+ * Pick up the readings of a newly completed ADC sweep, if there is one,
+ * and scale them. The first sweep sets each axis' centre.
+ */
+void update_analog_axes()
+{
+  uint16_t value[ANALOG_CHANNELS];
+  uint8_t sweeps = analog_adc.sweeps;
+  uint8_t ch;
+
+  if (sweeps == analog_sweeps_done) {
+    return;
+  }
+  analog_sweeps_done = sweeps;
+  analog_adc_read(&analog_adc, value);
+
+  if (!analog_calibrated) {
+    for (ch = 0; ch < ANALOG_CHANNELS; ch++) {
+      analog_cal_init(&analog_cal[ch], value[ch]);
+    }
+    analog_calibrated = true;
+  }
+
+  for (ch = 0; ch < ANALOG_CHANNELS; ch++) {
+    analog_axis[ch] = analog_axis_scale(&analog_cal[ch], value[ch]);
+  }
+}
+#endif
+
+/*
+ * Wait for the next scan tick. Returns the number of ticks since the last
+ * scan; anything above one means a deadline was missed.
+ */
+uint8_t wait_scan_tick()
+{
+  uint8_t ticks;
+
+  while ((ticks = scan_ticks) == scan_ticks_done) {
   }
+
+  ticks -= scan_ticks_done;
+  scan_ticks_done += ticks;
+  return ticks;
 }
 
 void update_joystick_state(int if_ix)
 {
-  int pin_base = PIN_FIRST + if_ix*PINS_PER_JOYSTICK;
-  joystick_state_t *state, *prev_state;
-  int ix, pin, val1, val2;
-  bool is_shifted;
+  joystick_state_t *state = &joy_state[if_ix];
+  uint16_t inputs = debounce.state[if_ix];
 
-  state = &joy_state[if_ix];
-  prev_state = &prev_joy_state[if_ix];
+  /*
+   * Autofire acts on the buttons as wired, before they are remapped.
+   */
+#if AUTOFIRE
+  inputs = autofire_inputs(&autofire, if_ix, inputs);
+#endif
+#if INPUT_REMAP
+  inputs = remap_inputs(inputs);
+#endif
 
   /*
-   * Get joystick inputs.
+   * Hold any edge until it has been sent.
    */
-  for (ix = AXIS_FIRST; ix < AXIS_NUM; ix++) {
-    if (ix == AXIS_X) {
-      pin = pin_base + JOY_AXIS_X;
-    } else {
-      pin = pin_base + JOY_AXIS_Y;
-    }
-    
-    val1 = digitalRead(pin);
-    val2 = digitalRead(pin + 1);
-    if ((val1 == 0) && (val2 == 0)) { /* Both activated; cancel */
-      state->axis[ix] = JOY_CENTRE;
-    } else if (val1 == 0) { /* Left/Up activated */
-      state->axis[ix] = JOY_LEFT_UP;
-    } else if (val2 == 0) { /* Right/Down activated */
-      state->axis[ix] = JOY_RIGHT_DOWN;
-    } else { /* Centred */
-      state->axis[ix] = JOY_CENTRE;
-    }
-  }
+  inputs = input_latch_update(&input_latch, if_ix, inputs);
+
+#if COMPACT_REPORT
+  /*
+   * Get the hat position from the joystick inputs; the buttons follow them
+   * in the inputs already in report order.
+   */
+  state->hat_buttons = hat_value[inputs & 0x0F] | (inputs & 0x0FF0);
+#else
+  /*
+   * Get joystick inputs. Analog sticks leave the switch inputs unused.
+   */
+#if ANALOG_AXES
+  state->axis[AXIS_X] = analog_axis[if_ix * AXIS_NUM + AXIS_X];
+  state->axis[AXIS_Y] = analog_axis[if_ix * AXIS_NUM + AXIS_Y];
+#else
+  state->axis[AXIS_X] = axis_value[(inputs >> JOY_AXIS_X) & 0x3];
+  state->axis[AXIS_Y] = axis_value[(inputs >> JOY_AXIS_Y) & 0x3];
+#endif
 
   /*
    * Get button inputs.
    */
-  state->buttons = 0;
-  pin_base += JOY_NUM;
+  state->buttons = (uint8_t)(inputs >> JOY_NUM);
+#endif
+}
+
+void send_link_frame(uint8_t type, const uint8_t *payload, uint8_t len)
+{
+  uint8_t frame_len;
+
+  frame_len = link_frame_encode(type, link_tx_seq++, payload, len,
+                                link_tx_buffer);
+  Serial.write(link_tx_buffer, frame_len);
+}
+
+uint16_t ms_to_ticks(uint16_t ms)
+{
+  return (uint16_t)(((uint32_t)ms * scan_rate_hz) / 1000);
+}
+
+void link_set_rate(uint8_t rate)
+{
+  Serial.flush();
+  Serial.begin(link_rate_baud[rate]);
+  link_rate = rate;
+  link_state_ticks = 0;
+}
 
-  for (ix = BUTTON_FIRST; ix <= BUTTON_NUM; ix++) {
-    button_state(state, ix, (digitalRead(pin_base + ix) == 0));
+/*
+ * Apply settings from the 16U2. A new scan rate restarts the timebase and
+ * autofire; a new link rate is negotiated from the current one.
+ */
+void link_apply_settings(const link_settings_t *settings)
+{
+  uint16_t rate_hz = SCAN_RATE_HZ;
+  uint8_t settle_ms = DEBOUNCE_MS;
+  uint8_t rate_target = LINK_RATE_TARGET;
+
+  if (settings->scan_rate_hz != LINK_SETTING_DEFAULT16) {
+    rate_hz = settings->scan_rate_hz;
+  }
+  if (settings->debounce_ms != LINK_SETTING_DEFAULT) {
+    settle_ms = settings->debounce_ms;
   }
+  if (settings->link_rate != LINK_SETTING_DEFAULT) {
+    rate_target = settings->link_rate;
+  }
+  link_delta_mode = (settings->report_mode != LINK_SETTING_DEFAULT) ?
+                    (settings->report_mode == LINK_REPORT_DELTAS) :
+                    LINK_DELTA_MODE;
+
+  if (rate_hz != scan_rate_hz) {
+    scan_rate_hz = rate_hz;
+    scan_timer_start(scan_rate_hz);
+#if AUTOFIRE
+    autofire_init(&autofire, scan_rate_hz);
+#endif
+  }
+  debounce_set_samples(&debounce, debounce_samples(settle_ms, scan_rate_hz));
+
+  if (rate_target != link_rate_target) {
+    link_rate_target = rate_target;
+    link_rate_limit = rate_target;
+    if (link_state == LINK_STATE_FAST) {
+      link_state = LINK_STATE_SAFE;
+      link_state_ticks = ms_to_ticks(LINK_RETRY_MS);
+    }
+  }
+  link_settings_received = true;
 }
 
-void send_joystick_state(int if_ix)
+/*
+ * Handle frames from the 16U2 and run the rate negotiation.
+ */
+void link_service(uint8_t ticks)
 {
+  link_settings_t settings;
+  const uint8_t *payload;
+  int rx_byte;
+  uint8_t len, rate;
+
+  while ((rx_byte = Serial.read()) >= 0) {
+    len = link_decoder_push(&link_rx_decoder, (uint8_t)rx_byte);
+    if (len == 0) {
+      continue;
+    }
+
+    payload = LINK_FRAME_PAYLOAD(&link_rx_decoder);
+    len = LINK_FRAME_PAYLOAD_LEN(len);
+    rate = payload[0];
+    switch (LINK_FRAME_TYPE(&link_rx_decoder)) {
+    case LINK_FRAME_RATE_ACK:
+      if ((len == 1) && (link_state == LINK_STATE_REQUESTED) &&
+          (rate == link_rate_limit)) {
+        link_set_rate(rate);
+        link_state = LINK_STATE_FAST;
+        link_fast_ticks = 0;
+      }
+      break;
+    case LINK_FRAME_STATUS:
+      if (len != 1) {
+        break;
+      }
+      link_peer_rate = rate;
+      link_peer_ticks = 0;
+      if ((link_state == LINK_STATE_FAST) && (rate == link_rate)) {
+        link_state_ticks = 0;
+      }
+      break;
+    case LINK_FRAME_SETTINGS:
+      if (len == sizeof(settings)) {
+        memcpy(&settings, payload, sizeof(settings));
+        if (link_settings_valid(&settings)) {
+          link_apply_settings(&settings);
+        }
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  link_state_ticks += ticks;
+  if (link_peer_ticks < ms_to_ticks(LINK_HEARTBEAT_TIMEOUT_MS)) {
+    link_peer_ticks += ticks;
+  } else if (link_rate == LINK_RATE_SAFE) {
+    /* Silent even at the safe rate: the 16U2 is away, not too slow. */
+    link_rate_limit = link_rate_target;
+  }
+
+  if (!link_settings_received && (link_state != LINK_STATE_REQUESTED)) {
+    if (link_settings_wait > ticks) {
+      link_settings_wait -= ticks;
+    } else {
+      send_link_frame(LINK_FRAME_SETTINGS_REQUEST, NULL, 0);
+      link_settings_wait = ms_to_ticks(LINK_RETRY_MS);
+    }
+  }
+
+  switch (link_state) {
+  case LINK_STATE_SAFE:
+    if ((link_rate_limit != link_rate) &&
+        (link_state_ticks >= ms_to_ticks(LINK_RETRY_MS))) {
+      send_link_frame(LINK_FRAME_RATE_REQUEST, &link_rate_limit, 1);
+      link_state = LINK_STATE_REQUESTED;
+      link_state_ticks = 0;
+    }
+    break;
+  case LINK_STATE_REQUESTED:
+    if (link_state_ticks >= ms_to_ticks(LINK_RETRY_MS)) {
+      link_state = LINK_STATE_SAFE;
+      link_state_ticks = 0;
+    }
+    break;
+  case LINK_STATE_FAST:
+    if (link_fast_ticks < ms_to_ticks(LINK_PROBATION_MS)) {
+      link_fast_ticks += ticks;
+    }
+    if (link_state_ticks >= ms_to_ticks(LINK_HEARTBEAT_TIMEOUT_MS)) {
+      /*
+       * The 16U2 has gone quiet: it has fallen back, errors are
+       * corrupting its status frames, or it has reset. Fall back, and aim
+       * lower only if this rate failed soon after it was reached.
+       */
+      if (link_fast_ticks < ms_to_ticks(LINK_PROBATION_MS)) {
+        if (link_rate_limit > LINK_RATE_SAFE) {
+          link_rate_limit--;
+        }
+      } else {
+        link_rate_limit = link_rate_target;
+      }
+      link_set_rate(LINK_RATE_SAFE);
+      link_state = LINK_STATE_SAFE;
+      link_peer_ticks = 0;
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+void print_joystick_state(int if_ix)
+{
+  Serial.print("Joystick: ");
+  Serial.println(if_ix);
+#if COMPACT_REPORT
+  Serial.print("Hat: ");
+  Serial.println(joy_state[if_ix].hat_buttons & 0x0F);
+  Serial.print("Buttons: ");
+  Serial.println(joy_state[if_ix].hat_buttons >> 4, HEX);
+#else
+  Serial.print("X: ");
+  Serial.println(joy_state[if_ix].axis[AXIS_X]);
+  Serial.print("Y: ");
+  Serial.println(joy_state[if_ix].axis[AXIS_Y]);
+  Serial.print("Buttons: ");
+  Serial.println(joy_state[if_ix].buttons, HEX);
+#endif
+}
+
+void send_joystick_states()
+{
+  int if_ix;
+#if COMPACT_REPORT
+  uint8_t payload[LINK_STATE_PAYLOAD_SIZE(IF_NUM)];
+#endif
+
   if (!debug) {
-    Serial.write((uint8_t *)&joy_state[if_ix], sizeof(joystick_state_t));
+#if COMPACT_REPORT
+    send_link_frame(LINK_FRAME_STATE, payload,
+                    link_states_pack((const uint8_t *)joy_state, IF_NUM,
+                                     payload));
+#else
+    send_link_frame(LINK_FRAME_STATE, (uint8_t *)joy_state,
+                    sizeof(joystick_state_t)*IF_NUM);
+#endif
   } else {
-    Serial.print("Joystick: ");
-    Serial.println(if_ix);
-    Serial.print("X: ");
-    Serial.println(joy_state[if_ix].axis[AXIS_X]);
-    Serial.print("Y: ");
-    Serial.println(joy_state[if_ix].axis[AXIS_Y]);
-    Serial.print("Buttons: ");
-    Serial.println(joy_state[if_ix].buttons, HEX);
+    for (if_ix = IF_FIRST; if_ix < IF_NUM; if_ix++) {
+      print_joystick_state(if_ix);
+    }
+    Serial.print("Missed deadlines: ");
+    Serial.println(missed_deadlines);
   }
 
   /*
    * Save reported state.
    */
-  memcpy((uint8_t *)&prev_joy_state[if_ix],
-         (uint8_t *)&joy_state[if_ix],
-         sizeof(joystick_state_t));
+  memcpy((uint8_t *)prev_joy_state, (uint8_t *)joy_state,
+         sizeof(joystick_state_t)*IF_NUM);
+  for (if_ix = IF_FIRST; if_ix < IF_NUM; if_ix++) {
+    input_latch_sent(&input_latch, if_ix);
+  }
+  keyframe_ticks = 0;
+}
+
+void send_joystick_deltas()
+{
+  uint8_t payload[LINK_PAYLOAD_MAX];
+  uint8_t len = 0;
+  int if_ix;
+
+  for (if_ix = IF_FIRST; if_ix < IF_NUM; if_ix++) {
+    /*
+     * A player whose state is unchanged has nothing to send, but the host
+     * already has what would have been.
+     */
+    input_latch_sent(&input_latch, if_ix);
+    if (memcmp(&joy_state[if_ix], &prev_joy_state[if_ix],
+               sizeof(joystick_state_t)) == 0) {
+      continue;
+    }
+
+#if COMPACT_REPORT
+    payload[len++] = (uint8_t)joy_state[if_ix].hat_buttons;
+    payload[len++] = (uint8_t)(joy_state[if_ix].hat_buttons >> 8) |
+                     (if_ix << 4);
+#else
+    payload[len++] = if_ix;
+    memcpy(&payload[len], &joy_state[if_ix], sizeof(joystick_state_t));
+    len += sizeof(joystick_state_t);
+#endif
+
+    if (debug) {
+      print_joystick_state(if_ix);
+    }
+
+    /*
+     * Save reported state.
+     */
+    memcpy(&prev_joy_state[if_ix], &joy_state[if_ix],
+           sizeof(joystick_state_t));
+  }
+
+  if (len && !debug) {
+    send_link_frame(LINK_FRAME_DELTA, payload, len);
+  }
 }
 
 void loop()
 {
-  bool force_send = false;
+  uint8_t ticks;
   int if_ix;
 
   /*
-   * Synchronization.
+   * Scheduling.
    */
-  if ((millis() - last_sync_timestamp) > 1000) {
-    send_sync();
-    force_send = true;
-  }
+  ticks = wait_scan_tick();
+  missed_deadlines += ticks - 1;
 
   /*
    * Read joystick states.
    */
+  input_snapshot_sample(&input_snapshot);
+  input_snapshot_decode(&input_snapshot, joy_inputs);
+  debounce_update(&debounce, joy_inputs);
+#if AUTOFIRE
+  autofire_update(&autofire, ticks, debounce.state);
+#endif
+#if ANALOG_AXES
+  update_analog_axes();
+#endif
+
   for (if_ix = IF_FIRST; if_ix < IF_NUM; if_ix++) {
     update_joystick_state(if_ix);
   }
 
   /*
-   * Send report.
+   * Serial link.
    */
-  if (force_send ||
-    memcmp(&joy_state, &prev_joy_state,
-           sizeof(joystick_state_t)*IF_NUM)) {
-    for (if_ix = IF_FIRST; if_ix < IF_NUM; if_ix++) {
-      send_joystick_state(if_ix);
-    }
+  if (!debug) {
+    link_service(ticks);
   }
 
-  delay(10);
+  /*
+   * Send report. Reports are held back while a rate change is pending, so
+   * nothing is sent as the 16U2 switches; changes go out after.
+   */
+  keyframe_ticks += ticks;
+  if (link_state == LINK_STATE_REQUESTED) {
+    /* Hold. */
+  } else if (link_delta_mode &&
+      (keyframe_ticks >= ms_to_ticks(LINK_KEYFRAME_MS))) {
+    send_joystick_states();
+  } else if (link_delta_mode) {
+    send_joystick_deltas();
+  } else if (memcmp(&joy_state, &prev_joy_state,
+                    sizeof(joystick_state_t)*IF_NUM)) {
+    send_joystick_states();
+  }
 }
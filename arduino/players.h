@@ -0,0 +1,52 @@
+/* USB HID Multiplayer Joystick */
+/* Author: Matthew Nikkanen
+ * Released into public domain.
+ */
+
+/*
+ * Player count, shared by the sketch (Mega 2560) and the USB firmware
+ * (16U2) so the two always agree. Everything sized per player derives from
+ * PLAYER_NUM: scanned inputs, link payloads, USB interfaces, endpoints and
+ * descriptors.
+ */
+
+#ifndef _PLAYERS_H_
+#define _PLAYERS_H_
+
+/**
+ * Number of players. May be overridden at build time, with the same value
+ * for both chips. It must be a plain number, for PLAYER_REPEAT().
+ *
+ * Up to four players get a USB interface each. Beyond that, players share
+ * interfaces and are told apart by HID report ID (see descriptors.h).
+ */
+#ifndef PLAYER_NUM
+#define PLAYER_NUM          4
+#endif
+
+#define PLAYER_NUM_MAX      8
+
+#if (PLAYER_NUM < 1) || (PLAYER_NUM > PLAYER_NUM_MAX)
+#error "PLAYER_NUM must be between 1 and PLAYER_NUM_MAX"
+#endif
+
+/*
+ * Expand macro(n) for n from 0 to num - 1, in order, for generating tables
+ * and initialisers at compile time. num must expand to a plain number.
+ */
+#define REPEAT_1(macro)         macro(0)
+#define REPEAT_2(macro)         REPEAT_1(macro) macro(1)
+#define REPEAT_3(macro)         REPEAT_2(macro) macro(2)
+#define REPEAT_4(macro)         REPEAT_3(macro) macro(3)
+#define REPEAT_5(macro)         REPEAT_4(macro) macro(4)
+#define REPEAT_6(macro)         REPEAT_5(macro) macro(5)
+#define REPEAT_7(macro)         REPEAT_6(macro) macro(6)
+#define REPEAT_8(macro)         REPEAT_7(macro) macro(7)
+
+#define REPEAT_N(num, macro)    REPEAT_##num(macro)
+#define REPEAT(num, macro)      REPEAT_N(num, macro)
+
+/** Expand macro(n) once for each player n. */
+#define PLAYER_REPEAT(macro)    REPEAT(PLAYER_NUM, macro)
+
+#endif /* _PLAYERS_H_ */
@@ -0,0 +1,191 @@
+/* USB HID Multiplayer Joystick */
+/* Author: Matthew Nikkanen
+ * Released into public domain.
+ */
+
+/*
+ * Port-register input sampling for the Arduino Mega 2560.
+ *
+ * Rather than calling digitalRead() once per pin, the scan takes a snapshot
+ * of every PINx register that carries joystick inputs, then derives each
+ * player's inputs from that snapshot with constant shifts and masks.
+ *
+ * Each player's inputs are returned as a word with one bit per pin, in pin
+ * order starting at the player's first pin: the four joystick switches
+ * (left, right, up, down) followed by the eight buttons. A set bit means
+ * the input is active (the pin is pulled low).
+ */
+
+#ifndef _PORT_SCAN_H_
+#define _PORT_SCAN_H_
+
+#include <stdint.h>
+
+#include "players.h"
+
+/** Number of players wired to the direct GPIO pins. */
+#define PORT_SCAN_PLAYER_NUM    PLAYER_NUM
+
+/*
+ * Pins 2 to 61 hold five players. Pins 0 and 1 carry the serial link, and
+ * the analog pins past A7 are too few for another player.
+ */
+#define PORT_SCAN_PLAYER_MAX    5
+
+#if PORT_SCAN_PLAYER_NUM > PORT_SCAN_PLAYER_MAX
+#error "Too many players for the direct GPIO pins; use INPUT_SHIFT_REGISTERS"
+#endif
+
+/** Ports carrying joystick inputs, in snapshot order. */
+typedef enum port_e_ {
+  PORT_FIRST = 0,
+  PORT_A     = PORT_FIRST,
+  PORT_B,
+  PORT_C,
+  PORT_D,
+  PORT_E,
+  PORT_F,
+  PORT_G,
+  PORT_H,
+  PORT_J,
+  PORT_L,
+  PORT_NUM,
+} port_e;
+
+/** Inverted PINx register values; a set bit is an active (low) pin. */
+typedef struct port_snapshot_t_ {
+  uint8_t pin[PORT_NUM];
+} port_snapshot_t;
+
+/*
+ * Mega 2560 digital pin to port/bit mapping, for the pins used by the
+ * joysticks (PIN_FIRST onwards).
+ */
+#define MEGA_PIN_2    PORT_E, 4
+#define MEGA_PIN_3    PORT_E, 5
+#define MEGA_PIN_4    PORT_G, 5
+#define MEGA_PIN_5    PORT_E, 3
+#define MEGA_PIN_6    PORT_H, 3
+#define MEGA_PIN_7    PORT_H, 4
+#define MEGA_PIN_8    PORT_H, 5
+#define MEGA_PIN_9    PORT_H, 6
+#define MEGA_PIN_10   PORT_B, 4
+#define MEGA_PIN_11   PORT_B, 5
+#define MEGA_PIN_12   PORT_B, 6
+#define MEGA_PIN_13   PORT_B, 7
+#define MEGA_PIN_14   PORT_J, 1
+#define MEGA_PIN_15   PORT_J, 0
+#define MEGA_PIN_16   PORT_H, 1
+#define MEGA_PIN_17   PORT_H, 0
+#define MEGA_PIN_18   PORT_D, 3
+#define MEGA_PIN_19   PORT_D, 2
+#define MEGA_PIN_20   PORT_D, 1
+#define MEGA_PIN_21   PORT_D, 0
+#define MEGA_PIN_22   PORT_A, 0
+#define MEGA_PIN_23   PORT_A, 1
+#define MEGA_PIN_24   PORT_A, 2
+#define MEGA_PIN_25   PORT_A, 3
+#define MEGA_PIN_26   PORT_A, 4
+#define MEGA_PIN_27   PORT_A, 5
+#define MEGA_PIN_28   PORT_A, 6
+#define MEGA_PIN_29   PORT_A, 7
+#define MEGA_PIN_30   PORT_C, 7
+#define MEGA_PIN_31   PORT_C, 6
+#define MEGA_PIN_32   PORT_C, 5
+#define MEGA_PIN_33   PORT_C, 4
+#define MEGA_PIN_34   PORT_C, 3
+#define MEGA_PIN_35   PORT_C, 2
+#define MEGA_PIN_36   PORT_C, 1
+#define MEGA_PIN_37   PORT_C, 0
+#define MEGA_PIN_38   PORT_D, 7
+#define MEGA_PIN_39   PORT_G, 2
+#define MEGA_PIN_40   PORT_G, 1
+#define MEGA_PIN_41   PORT_G, 0
+#define MEGA_PIN_42   PORT_L, 7
+#define MEGA_PIN_43   PORT_L, 6
+#define MEGA_PIN_44   PORT_L, 5
+#define MEGA_PIN_45   PORT_L, 4
+#define MEGA_PIN_46   PORT_L, 3
+#define MEGA_PIN_47   PORT_L, 2
+#define MEGA_PIN_48   PORT_L, 1
+#define MEGA_PIN_49   PORT_L, 0
+#define MEGA_PIN_50   PORT_B, 3
+#define MEGA_PIN_51   PORT_B, 2
+#define MEGA_PIN_52   PORT_B, 1
+#define MEGA_PIN_53   PORT_B, 0
+#define MEGA_PIN_54   PORT_F, 0   /* A0 */
+#define MEGA_PIN_55   PORT_F, 1
+#define MEGA_PIN_56   PORT_F, 2
+#define MEGA_PIN_57   PORT_F, 3
+#define MEGA_PIN_58   PORT_F, 4
+#define MEGA_PIN_59   PORT_F, 5
+#define MEGA_PIN_60   PORT_F, 6
+#define MEGA_PIN_61   PORT_F, 7   /* A7 */
+
+/*
+ * Input extraction. The extra level of indirection lets MEGA_PIN_n expand
+ * into its port and bit arguments before PORT_INPUT_BIT() is applied.
+ */
+#define PORT_INPUT_BIT(snap, port, bit, in) \
+  ((uint16_t)(((snap)->pin[port] >> (bit)) & 1) << (in))
+#define PORT_INPUT(snap, mega_pin, in)  PORT_INPUT_BIT(snap, mega_pin, in)
+
+#define PORT_PLAYER_INPUTS(snap, p0, p1, p2, p3, p4, p5,                 \
+                           p6, p7, p8, p9, p10, p11)                     \
+  (PORT_INPUT(snap, MEGA_PIN_##p0, 0)  | PORT_INPUT(snap, MEGA_PIN_##p1, 1) | \
+   PORT_INPUT(snap, MEGA_PIN_##p2, 2)  | PORT_INPUT(snap, MEGA_PIN_##p3, 3) | \
+   PORT_INPUT(snap, MEGA_PIN_##p4, 4)  | PORT_INPUT(snap, MEGA_PIN_##p5, 5) | \
+   PORT_INPUT(snap, MEGA_PIN_##p6, 6)  | PORT_INPUT(snap, MEGA_PIN_##p7, 7) | \
+   PORT_INPUT(snap, MEGA_PIN_##p8, 8)  | PORT_INPUT(snap, MEGA_PIN_##p9, 9) | \
+   PORT_INPUT(snap, MEGA_PIN_##p10, 10) | PORT_INPUT(snap, MEGA_PIN_##p11, 11))
+
+/*
+ * Take a snapshot of all the input ports. The registers are read back to
+ * back, so all the inputs are sampled within a few cycles of each other.
+ * Port F is only read when the fifth player is built in.
+ */
+static inline void port_snapshot_sample(port_snapshot_t *snap)
+{
+  snap->pin[PORT_A] = ~PINA;
+  snap->pin[PORT_B] = ~PINB;
+  snap->pin[PORT_C] = ~PINC;
+  snap->pin[PORT_D] = ~PIND;
+  snap->pin[PORT_E] = ~PINE;
+#if PORT_SCAN_PLAYER_NUM > 4
+  snap->pin[PORT_F] = ~PINF;
+#endif
+  snap->pin[PORT_G] = ~PING;
+  snap->pin[PORT_H] = ~PINH;
+  snap->pin[PORT_J] = ~PINJ;
+  snap->pin[PORT_L] = ~PINL;
+}
+
+/*
+ * Derive every player's input word from a port snapshot. Players are wired
+ * to consecutive runs of 12 pins starting at pin 2; only the players that
+ * are built in are decoded.
+ */
+static inline void port_snapshot_decode(const port_snapshot_t *snap,
+                                        uint16_t inputs[PORT_SCAN_PLAYER_NUM])
+{
+  inputs[0] = PORT_PLAYER_INPUTS(snap,  2,  3,  4,  5,  6,  7,
+                                        8,  9, 10, 11, 12, 13);
+#if PORT_SCAN_PLAYER_NUM > 1
+  inputs[1] = PORT_PLAYER_INPUTS(snap, 14, 15, 16, 17, 18, 19,
+                                       20, 21, 22, 23, 24, 25);
+#endif
+#if PORT_SCAN_PLAYER_NUM > 2
+  inputs[2] = PORT_PLAYER_INPUTS(snap, 26, 27, 28, 29, 30, 31,
+                                       32, 33, 34, 35, 36, 37);
+#endif
+#if PORT_SCAN_PLAYER_NUM > 3
+  inputs[3] = PORT_PLAYER_INPUTS(snap, 38, 39, 40, 41, 42, 43,
+                                       44, 45, 46, 47, 48, 49);
+#endif
+#if PORT_SCAN_PLAYER_NUM > 4
+  inputs[4] = PORT_PLAYER_INPUTS(snap, 50, 51, 52, 53, 54, 55,
+                                       56, 57, 58, 59, 60, 61);
+#endif
+}
+
+#endif /* _PORT_SCAN_H_ */
@@ -0,0 +1,49 @@
+/* USB HID Multiplayer Joystick */
+/* Author: Matthew Nikkanen
+ * Released into public domain.
+ */
+
+/*
+ * Fixed-rate scan timebase.
+ *
+ * Timer1 runs in CTC mode and raises a compare interrupt once per scan
+ * period. The interrupt only advances a tick counter; loop() waits for the
+ * counter to move, so input sampling happens on a fixed grid independent of
+ * how long the previous pass took. Timer0 is left alone for millis().
+ */
+
+#ifndef _SCAN_TIMER_H_
+#define _SCAN_TIMER_H_
+
+#include <stdint.h>
+#include <avr/io.h>
+
+/** Default scan rate, in Hz. May be overridden at build time. */
+#ifndef SCAN_RATE_HZ
+#define SCAN_RATE_HZ        1000
+#endif
+
+/** Timer1 clock: F_CPU / 8, giving 0.5 us resolution at 16 MHz. */
+#define SCAN_TIMER_PRESCALE 8
+#define SCAN_TIMER_HZ       (F_CPU / SCAN_TIMER_PRESCALE)
+
+#if (SCAN_TIMER_HZ / SCAN_RATE_HZ) > 0x10000
+#error "SCAN_RATE_HZ is too low for the Timer1 prescaler"
+#endif
+
+/*
+ * Start Timer1 ticking at the given rate. The tick counter itself lives in
+ * the sketch, alongside the TIMER1_COMPA_vect handler.
+ */
+static inline void scan_timer_start(uint16_t rate_hz)
+{
+  TCCR1A = 0;
+  TCCR1B = 0;
+  TCNT1  = 0;
+  OCR1A  = (uint16_t)((SCAN_TIMER_HZ / rate_hz) - 1);
+  TIFR1  = (1 << OCF1A);
+  TIMSK1 = (1 << OCIE1A);
+  TCCR1B = (1 << WGM12) | (1 << CS11); /* CTC on OCR1A, clk/8 */
+}
+
+#endif /* _SCAN_TIMER_H_ */
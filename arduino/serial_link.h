@@ -0,0 +1,430 @@
+/* USB HID Multiplayer Joystick */
+/* Author: Matthew Nikkanen
+ * Released into public domain.
+ */
+
+/*
+ * Serial link framing, shared by the sketch (Mega 2560) and the USB
+ * firmware (16U2).
+ *
+ * A frame is a type byte, a sequence number, a payload and a CRC-8 over
+ * all of those, encoded with COBS (Consistent Overhead Byte Stuffing) and
+ * terminated by a zero byte:
+ *
+ *   COBS( type | seq | payload... | crc ) | 0x00
+ *
+ * COBS guarantees the encoded frame contains no zero bytes, so the
+ * delimiter can never appear in data and the receiver re-synchronises at
+ * the next delimiter after any corruption. Frames that fail the CRC are
+ * dropped rather than delivered.
+ *
+ * This file is plain C so it can be built for either chip, or the host.
+ */
+
+#ifndef _SERIAL_LINK_H_
+#define _SERIAL_LINK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/** Frame types. */
+typedef enum link_frame_type_e_ {
+  LINK_FRAME_STATE = 0x01,  /* Joystick states for all players */
+  LINK_FRAME_DELTA = 0x02,  /* Joystick states for changed players only */
+  LINK_FRAME_RATE_REQUEST = 0x03, /* Mega: switch to rate payload[0] */
+  LINK_FRAME_RATE_ACK     = 0x04, /* 16U2: switching to rate payload[0] */
+  LINK_FRAME_STATUS       = 0x05, /* 16U2: heartbeat, current rate */
+  LINK_FRAME_SETTINGS_REQUEST = 0x06, /* Mega: send the settings */
+  LINK_FRAME_SETTINGS     = 0x07, /* 16U2: settings, link_settings_t */
+} link_frame_type_e;
+
+/*
+ * Payloads.
+ *
+ * A STATE frame carries one joystick state per player, in player order.
+ * A DELTA frame carries one record per changed player: the player's
+ * index followed by its state.
+ *
+ * COMPACT_REPORT, which must be set the same for both chips, replaces the
+ * two axes with a 4-bit hat switch, packed with the buttons into a 12-bit
+ * state: the hat in bits 0-3 and the buttons in bits 4-11, as the USB
+ * report lays them out. STATE frames then pack the players' states back
+ * to back, two players to three bytes, and each DELTA record is a single
+ * little-endian word, the player's index in its top four bits.
+ */
+#ifndef COMPACT_REPORT
+#define COMPACT_REPORT          0
+#endif
+
+#if COMPACT_REPORT
+#define LINK_PLAYER_STATE_SIZE  2   /* Hat and buttons, little endian */
+#define LINK_DELTA_RECORD_SIZE  2
+#define LINK_DELTA_PLAYER(rec)  ((rec)[1] >> 4)
+#define LINK_STATE_PAYLOAD_SIZE(players)    (((players) * 12 + 7) / 8)
+#define LINK_HAT_NONE           8   /* Hat centred: outside 0 (N) to 7 (NW) */
+#else
+#define LINK_PLAYER_STATE_SIZE  3   /* X axis, Y axis, buttons */
+#define LINK_DELTA_RECORD_SIZE  (1 + LINK_PLAYER_STATE_SIZE)
+#define LINK_DELTA_PLAYER(rec)  ((rec)[0])
+#define LINK_STATE_PAYLOAD_SIZE(players)    ((players) * LINK_PLAYER_STATE_SIZE)
+#endif
+
+#if COMPACT_REPORT
+/*
+ * Pack players' 12-bit states, each held in two bytes, into a STATE frame
+ * payload. Returns the payload length.
+ */
+static inline uint8_t link_states_pack(const uint8_t *states, uint8_t num,
+                                       uint8_t *out)
+{
+  uint8_t len = 0;
+  uint8_t player;
+
+  for (player = 0; player < num; player++, states += 2) {
+    if (!(player & 1)) {
+      out[len++] = states[0];
+      out[len++] = states[1] & 0x0F;
+    } else {
+      out[len - 1] |= (uint8_t)(states[0] << 4);
+      out[len++] = (uint8_t)(states[0] >> 4) | (uint8_t)(states[1] << 4);
+    }
+  }
+  return len;
+}
+
+/* Unpack one player's state from a STATE frame payload into two bytes. */
+static inline void link_states_unpack(const uint8_t *payload, uint8_t player,
+                                      uint8_t *state)
+{
+  const uint8_t *in = &payload[(player >> 1) * 3];
+
+  if (!(player & 1)) {
+    state[0] = in[0];
+    state[1] = in[1] & 0x0F;
+  } else {
+    state[0] = (uint8_t)(in[1] >> 4) | (uint8_t)(in[2] << 4);
+    state[1] = in[2] >> 4;
+  }
+}
+#endif
+
+/*
+ * Axis values in a player state. Switch-operated sticks report the ends
+ * and centre of the range 0 to 100. ANALOG_AXES, which must be set the
+ * same for both chips, reads the sticks' axes from the ADC instead and
+ * widens the range to 0 to 255.
+ */
+#ifndef ANALOG_AXES
+#define ANALOG_AXES             0
+#endif
+
+#if ANALOG_AXES
+#define LINK_AXIS_MAX           255
+#else
+#define LINK_AXIS_MAX           100
+#endif
+
+#if ANALOG_AXES && COMPACT_REPORT
+#error "The compact report has no axes for analog sticks"
+#endif
+
+/*
+ * Link rates.
+ *
+ * Both ends start at LINK_RATE_SAFE. The Mega asks for a faster rate with a
+ * RATE_REQUEST frame; the 16U2 answers with a RATE_ACK at the old rate and
+ * then switches, and the Mega switches when it sees the ACK.
+ *
+ * The 16U2 sends a STATUS frame every LINK_HEARTBEAT_MS at its current
+ * rate. It drops back to the safe rate if it sees LINK_ERROR_LIMIT or more
+ * framing, overrun or frame errors within one heartbeat period. The Mega
+ * drops back if it hears no STATUS frame for LINK_HEARTBEAT_TIMEOUT_MS.
+ * Either way both ends end up at the safe rate, from where the Mega
+ * negotiates again: a step lower if the rate failed soon after it was
+ * reached, otherwise at its configured target.
+ *
+ * All rates are exact with U2X at 16 MHz, except 115200 (2.1% error).
+ */
+typedef enum link_rate_e_ {
+  LINK_RATE_115200 = 0,
+  LINK_RATE_500K,
+  LINK_RATE_1M,
+  LINK_RATE_2M,
+  LINK_RATE_NUM,
+} link_rate_e;
+
+#define LINK_RATE_SAFE              LINK_RATE_115200
+
+static const uint32_t link_rate_baud[LINK_RATE_NUM] = {
+  115200, 500000, 1000000, 2000000,
+};
+
+#define LINK_HEARTBEAT_MS           100
+#define LINK_HEARTBEAT_TIMEOUT_MS   500
+#define LINK_ERROR_LIMIT            8
+
+/*
+ * Settings.
+ *
+ * Runtime settings are kept by the 16U2 in EEPROM, and read and written
+ * by the host with vendor requests (see vendor_requests.h). The Mega asks
+ * for them with a SETTINGS_REQUEST frame until it has them, and the 16U2
+ * sends a SETTINGS frame again whenever the host changes them.
+ *
+ * A field left at its erased value, all ones, keeps the build-time
+ * default of the chip that uses it, so an erased EEPROM changes nothing.
+ * The player count and the report format change the USB descriptors, so
+ * they stay build-time options.
+ */
+#define LINK_SETTINGS_VERSION       1
+#define LINK_SETTING_DEFAULT        0xFF
+#define LINK_SETTING_DEFAULT16      0xFFFF
+
+typedef enum link_report_mode_e_ {
+  LINK_REPORT_STATES = 0,   /* A STATE frame whenever anything changes */
+  LINK_REPORT_DELTAS,       /* DELTA frames, and a periodic STATE frame */
+  LINK_REPORT_MODE_NUM,
+} link_report_mode_e;
+
+/** Scan rate and settle time limits, in Hz and milliseconds. */
+#define LINK_SCAN_RATE_MIN          100
+#define LINK_SCAN_RATE_MAX          2000
+#define LINK_DEBOUNCE_MS_MAX        50
+
+/** Idle rates are in HID's 4 ms units, up to a byte's worth. */
+#define LINK_IDLE_MS_UNIT           4
+#define LINK_IDLE_MS_MAX            (255 * LINK_IDLE_MS_UNIT)
+
+typedef struct link_settings_t_ {
+  uint8_t  version;         /* LINK_SETTINGS_VERSION */
+  uint8_t  link_rate;       /* Mega: link rate to negotiate, link_rate_e */
+  uint16_t scan_rate_hz;    /* Mega: input scan rate */
+  uint8_t  debounce_ms;     /* Mega: debounce settle time */
+  uint8_t  report_mode;     /* Mega: link_report_mode_e */
+  uint16_t idle_ms;         /* 16U2: idle rate until the host sets one,
+                               in 4 ms units, up to LINK_IDLE_MS_MAX */
+} link_settings_t;
+
+static inline bool link_settings_valid(const link_settings_t *settings)
+{
+  return (settings->version == LINK_SETTINGS_VERSION) &&
+         ((settings->link_rate < LINK_RATE_NUM) ||
+          (settings->link_rate == LINK_SETTING_DEFAULT)) &&
+         (((settings->scan_rate_hz >= LINK_SCAN_RATE_MIN) &&
+           (settings->scan_rate_hz <= LINK_SCAN_RATE_MAX)) ||
+          (settings->scan_rate_hz == LINK_SETTING_DEFAULT16)) &&
+         ((settings->debounce_ms <= LINK_DEBOUNCE_MS_MAX) ||
+          (settings->debounce_ms == LINK_SETTING_DEFAULT)) &&
+         ((settings->report_mode < LINK_REPORT_MODE_NUM) ||
+          (settings->report_mode == LINK_SETTING_DEFAULT)) &&
+         (((settings->idle_ms <= LINK_IDLE_MS_MAX) &&
+           (settings->idle_ms % LINK_IDLE_MS_UNIT == 0)) ||
+          (settings->idle_ms == LINK_SETTING_DEFAULT16));
+}
+
+/* Settings with every field at its default. */
+static inline void link_settings_default(link_settings_t *settings)
+{
+  memset(settings, 0xFF, sizeof(*settings));
+  settings->version = LINK_SETTINGS_VERSION;
+}
+
+/** Frame layout, before encoding. */
+#define LINK_HEADER_SIZE        2   /* type, seq */
+#define LINK_CRC_SIZE           1
+#define LINK_OVERHEAD           (LINK_HEADER_SIZE + LINK_CRC_SIZE)
+#define LINK_PAYLOAD_MAX        32
+#define LINK_FRAME_MAX          (LINK_PAYLOAD_MAX + LINK_OVERHEAD)
+
+/** Encoded size: one COBS code byte per 254 data bytes, plus delimiter. */
+#define LINK_ENCODED_MAX        (LINK_FRAME_MAX + 2)
+
+#define LINK_DELIMITER          0x00
+
+#if LINK_FRAME_MAX > 254
+#error "Link frames must fit in a single COBS block"
+#endif
+
+/*
+ * CRC-8, polynomial 0x07, initial value 0x00. A nibble table keeps it at
+ * two lookups per byte without the flash cost of a full table.
+ */
+static const uint8_t link_crc8_table[16] = {
+  0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15,
+  0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D,
+};
+
+static inline uint8_t link_crc8_update(uint8_t crc, uint8_t data)
+{
+  crc ^= data;
+  crc = (uint8_t)(crc << 4) ^ link_crc8_table[crc >> 4];
+  crc = (uint8_t)(crc << 4) ^ link_crc8_table[crc >> 4];
+  return crc;
+}
+
+static inline uint8_t link_crc8(const uint8_t *data, uint8_t len)
+{
+  uint8_t crc = 0;
+
+  while (len--) {
+    crc = link_crc8_update(crc, *data++);
+  }
+  return crc;
+}
+
+/*
+ * Encoder.
+ */
+
+/*
+ * Build and COBS-encode a frame into out, which must hold at least
+ * LINK_ENCODED_MAX bytes. Returns the number of bytes to transmit,
+ * including the trailing delimiter.
+ */
+static inline uint8_t link_frame_encode(uint8_t type, uint8_t seq,
+                                        const uint8_t *payload, uint8_t len,
+                                        uint8_t *out)
+{
+  uint8_t code_ix = 0;  /* Position of the current block's code byte */
+  uint8_t out_ix = 1;
+  uint8_t crc = 0;
+  uint8_t ix;
+
+  for (ix = 0; ix < (uint8_t)(len + LINK_OVERHEAD); ix++) {
+    uint8_t data;
+
+    if (ix == 0) {
+      data = type;
+    } else if (ix == 1) {
+      data = seq;
+    } else if (ix < (uint8_t)(len + LINK_HEADER_SIZE)) {
+      data = payload[ix - LINK_HEADER_SIZE];
+    } else {
+      data = crc;
+    }
+    crc = link_crc8_update(crc, data);
+
+    if (data == LINK_DELIMITER) {
+      /* Close the block; its code is the distance to this zero. */
+      out[code_ix] = out_ix - code_ix;
+      code_ix = out_ix++;
+    } else {
+      out[out_ix++] = data;
+    }
+  }
+
+  out[code_ix] = out_ix - code_ix;
+  out[out_ix++] = LINK_DELIMITER;
+  return out_ix;
+}
+
+/*
+ * Decoder.
+ */
+
+typedef struct link_decoder_t_ {
+  uint8_t  frame[LINK_FRAME_MAX]; /* Decoded bytes of the frame in progress */
+  uint8_t  len;                   /* Decoded length so far */
+  uint8_t  block_left;            /* Bytes left in the current COBS block */
+  bool     block_zero;            /* Current block ends in an implied zero */
+  bool     discard;               /* Drop bytes until the next delimiter */
+  uint8_t  last_seq;
+  bool     seq_valid;
+
+  /* Link statistics. */
+  uint16_t frames;                /* Valid frames delivered */
+  uint16_t crc_errors;            /* Frames dropped for a bad CRC */
+  uint16_t framing_errors;        /* Malformed or oversized frames */
+  uint16_t lost_frames;           /* Gaps in the sequence numbers */
+} link_decoder_t;
+
+static inline void link_decoder_init(link_decoder_t *dec)
+{
+  memset(dec, 0, sizeof(*dec));
+}
+
+/*
+ * Check a complete, decoded frame and account for it. Returns the frame
+ * length if it is valid, 0 otherwise.
+ */
+static inline uint8_t link_decoder_finish(link_decoder_t *dec)
+{
+  uint8_t len = dec->len;
+  uint8_t seq;
+
+  if ((len < LINK_OVERHEAD) || (dec->block_left != 0)) {
+    dec->framing_errors++;
+    return 0;
+  }
+  if (link_crc8(dec->frame, len) != 0) {
+    dec->crc_errors++;
+    return 0;
+  }
+
+  seq = dec->frame[1];
+  if (dec->seq_valid) {
+    dec->lost_frames += (uint8_t)(seq - dec->last_seq - 1);
+  }
+  dec->last_seq = seq;
+  dec->seq_valid = true;
+  dec->frames++;
+  return len;
+}
+
+/*
+ * Feed one received byte to the decoder. Returns the length of the frame
+ * now held in dec->frame when the byte completes a valid frame, 0 otherwise.
+ * The frame stays valid until the next byte is pushed.
+ */
+static inline uint8_t link_decoder_push(link_decoder_t *dec, uint8_t byte)
+{
+  uint8_t len = 0;
+
+  if (byte == LINK_DELIMITER) {
+    if (!dec->discard) {
+      len = link_decoder_finish(dec);
+    }
+    dec->len = 0;
+    dec->block_left = 0;
+    dec->block_zero = false;
+    dec->discard = false;
+    return len;
+  }
+
+  if (dec->discard) {
+    return 0;
+  }
+
+  if (dec->block_left == 0) {
+    /* Code byte: restore the zero that ended the previous block. */
+    if (dec->block_zero) {
+      if (dec->len >= LINK_FRAME_MAX) {
+        dec->framing_errors++;
+        dec->discard = true;
+        return 0;
+      }
+      dec->frame[dec->len++] = 0;
+    }
+    dec->block_left = byte - 1;
+    dec->block_zero = (byte != 0xFF);
+    return 0;
+  }
+
+  if (dec->len >= LINK_FRAME_MAX) {
+    dec->framing_errors++;
+    dec->discard = true;
+    return 0;
+  }
+  dec->frame[dec->len++] = byte;
+  dec->block_left--;
+  return 0;
+}
+
+/** Accessors for a frame returned by link_decoder_push(). */
+#define LINK_FRAME_TYPE(dec)        ((dec)->frame[0])
+#define LINK_FRAME_SEQ(dec)         ((dec)->frame[1])
+#define LINK_FRAME_PAYLOAD(dec)     (&(dec)->frame[LINK_HEADER_SIZE])
+#define LINK_FRAME_PAYLOAD_LEN(len) ((len) - LINK_OVERHEAD)
+
+#endif /* _SERIAL_LINK_H_ */
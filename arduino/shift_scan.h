@@ -0,0 +1,114 @@
+/* USB HID Multiplayer Joystick */
+/* Author: Matthew Nikkanen
+ * Released into public domain.
+ */
+
+/*
+ * 74HC165 shift-register input sampling over the Mega 2560's SPI port.
+ *
+ * Player inputs are wired to a chain of 74HC165 parallel-in, serial-out
+ * shift registers, two per player, so the number of players is not limited
+ * by the Mega's pins. A low pulse on the load line latches every input in
+ * the chain at once, then the chain is clocked out through the hardware SPI
+ * port a byte at a time.
+ *
+ * Wiring:
+ *
+ *   Mega pin 53 (PB0, SS)   -> SH/LD of every register
+ *   Mega pin 52 (PB1, SCK)  -> CLK of every register
+ *   Mega pin 50 (PB3, MISO) <- QH of the first register
+ *   QH of each register     -> SER of the next; SER of the last tied high
+ *   CLK INH of every register tied low
+ *
+ * The first register holds player 1's four joystick switches (left, right,
+ * up, down, on inputs A to D) and buttons 1 to 4 (E to H); the second holds
+ * buttons 5 to 8 (A to D), and its E to H are spare. Players follow in
+ * order. Inputs are pulled up, and a switch pulls its input low.
+ *
+ * Each player's inputs are returned as a word with the same bit order as
+ * port_scan.h, so the rest of the sketch does not know which backend is
+ * in use.
+ */
+
+#ifndef _SHIFT_SCAN_H_
+#define _SHIFT_SCAN_H_
+
+#include <stdint.h>
+#include <avr/io.h>
+
+#include "players.h"
+
+/** Number of players wired to the shift-register chain. */
+#define SHIFT_SCAN_PLAYER_NUM   PLAYER_NUM
+
+#define SHIFT_SCAN_REGS_PER_PLAYER  2
+#define SHIFT_SCAN_BYTES        (SHIFT_SCAN_PLAYER_NUM * \
+                                 SHIFT_SCAN_REGS_PER_PLAYER)
+
+/** Load line: pin 53, which is also SS and must be an output for SPI. */
+#define SHIFT_SCAN_LOAD_BIT     PB0
+#define SHIFT_SCAN_SCK_BIT      PB1
+#define SHIFT_SCAN_MOSI_BIT     PB2
+
+/** Inverted register contents; a set bit is an active (low) input. */
+typedef struct shift_snapshot_t_ {
+  uint8_t data[SHIFT_SCAN_BYTES];
+} shift_snapshot_t;
+
+/*
+ * Configure the SPI port as master, in mode 2 at F_CPU / 2. The 74HC165
+ * shifts on the rising clock edge, so its output is sampled on the falling
+ * one, with the clock idling high.
+ */
+static inline void shift_scan_setup(void)
+{
+  PORTB |= (1 << SHIFT_SCAN_LOAD_BIT);
+  DDRB  |= (1 << SHIFT_SCAN_LOAD_BIT) | (1 << SHIFT_SCAN_SCK_BIT) |
+           (1 << SHIFT_SCAN_MOSI_BIT);
+  SPCR   = (1 << SPE) | (1 << MSTR) | (1 << CPOL);
+  SPSR   = (1 << SPI2X);
+}
+
+/*
+ * Latch and read the whole chain. Each byte takes 16 cycles to clock out,
+ * and the next transfer is started before the previous byte is stored, so
+ * the SPI port is kept busy; eight players take about 20 microseconds.
+ */
+static inline void shift_snapshot_sample(shift_snapshot_t *snap)
+{
+  uint8_t ix;
+  uint8_t data;
+
+  PORTB &= ~(1 << SHIFT_SCAN_LOAD_BIT);
+  PORTB |= (1 << SHIFT_SCAN_LOAD_BIT);
+
+  SPDR = 0;
+  for (ix = 0; ix < SHIFT_SCAN_BYTES - 1; ix++) {
+    while (!(SPSR & (1 << SPIF))) {
+    }
+    data = SPDR;
+    SPDR = 0;
+    snap->data[ix] = ~data;
+  }
+  while (!(SPSR & (1 << SPIF))) {
+  }
+  snap->data[ix] = ~SPDR;
+}
+
+/*
+ * Derive every player's input word from a snapshot. Each register shifts
+ * out input H first, which the SPI port receives as the most significant
+ * bit, so input A lands in bit 0, already in pin order.
+ */
+static inline void shift_snapshot_decode(const shift_snapshot_t *snap,
+                                         uint16_t inputs[SHIFT_SCAN_PLAYER_NUM])
+{
+  const uint8_t *data = snap->data;
+  uint8_t player;
+
+  for (player = 0; player < SHIFT_SCAN_PLAYER_NUM; player++, data += 2) {
+    inputs[player] = data[0] | ((uint16_t)(data[1] & 0x0F) << 8);
+  }
+}
+
+#endif /* _SHIFT_SCAN_H_ */
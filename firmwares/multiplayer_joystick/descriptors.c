@@ -58,6 +58,15 @@
 
 #include "descriptors.h"
 
+/* Axis range: 0 to 100, or 0 to 255 for analog axes (see serial_link.h).
+ * A maximum above 127 needs a two-byte item, as logical values are signed.
+ */
+#if LINK_AXIS_MAX > 127
+#define JOYSTICK_AXIS_MAX       0x26, (LINK_AXIS_MAX & 0xFF), (LINK_AXIS_MAX >> 8)
+#else
+#define JOYSTICK_AXIS_MAX       0x25, LINK_AXIS_MAX
+#endif
+
 /** HID class report descriptor.
  *
  * This is a special descriptor constructed with values from the USBIF HID
@@ -66,55 +75,122 @@
  * determine what data (and in what encoding) the device will send, and what
  * it may be sent back from the host. Refer to the HID specification for
  * more details on HID report descriptors.
+ *
+ * It is built from the joystick collection and its inputs, which the shared
+ * report descriptor below repeats for each player.
+ */
+#define JOYSTICK_COLLECTION                                                \
+    0x05, 0x01,          /* Usage Page (Generic Desktop)                     */ \
+    0x09, 0x04,          /* Usage (Joystick)                                 */ \
+                                                                            \
+    0xa1, 0x01           /* Collection (Application)                         */
+
+#if COMPACT_REPORT
+/* Compact report: a hat switch for the D-pad, packed with the buttons into
+ * 12 bits (see serial_link.h).
  */
+#define JOYSTICK_INPUTS                                                    \
+    /* Hat switch, null (centred) outside 0-7. */                           \
+    0x09, 0x39,          /*   Usage (Hat switch)                             */ \
+    0x15, 0x00,          /*   Logical Minimum (0)                            */ \
+    0x25, 0x07,          /*   Logical Maximum (7)                            */ \
+    0x35, 0x00,          /*   Physical Minimum (0)                           */ \
+    0x46, 0x3B, 0x01,    /*   Physical Maximum (315)                         */ \
+    0x65, 0x14,          /*   Unit (Degrees)                                 */ \
+    0x75, 0x04,          /*   Report Size (4)                                */ \
+    0x95, 0x01,          /*   Report Count (1)                               */ \
+    0x81, 0x42,          /*   Input (Data, Variable, Absolute, Null)         */ \
+    0x65, 0x00,          /*   Unit (None)                                    */ \
+                                                                            \
+    /* 8 game buttons. */                                                   \
+    0x05, 0x09,          /*   Usage Page (Button)                            */ \
+    0x19, 0x01,          /*   Usage Minimum (1)                              */ \
+    0x29, 0x08,          /*   Usage Maximum (8)                              */ \
+    0x15, 0x00,          /*   Logical Minimum (0)                            */ \
+    0x25, 0x01,          /*   Logical Maximum (1)                            */ \
+    0x75, 0x01,          /*   Report Size (1)                                */ \
+    0x95, 0x08,          /*   Report Count (8)                               */ \
+    0x81, 0x02,          /*   Input (Data, Variable, Absolute)               */ \
+                                                                            \
+    /* Padding to a whole byte. */                                          \
+    0x75, 0x04,          /*   Report Size (4)                                */ \
+    0x95, 0x01,          /*   Report Count (1)                               */ \
+    0x81, 0x03,          /*   Input (Constant)                               */ \
+                                                                            \
+    0xC0                 /* End Collection                                   */
+#else
+#define JOYSTICK_INPUTS                                                    \
+    0x09, 0x01,          /*   Usage (Pointer)                                */ \
+                                                                            \
+    /* 2-axis joystick, treated as a D-pad. */                              \
+    0xa1, 0x00,          /*   Collection (Physical)                          */ \
+    0x05, 0x01,          /*     Usage Page (Generic Desktop)                 */ \
+    0x09, 0x30,          /*     Usage (X)                                    */ \
+    0x09, 0x31,          /*     Usage (Y)                                    */ \
+    0x15, 0x00,          /*     Logical Minimum (0)                          */ \
+    JOYSTICK_AXIS_MAX,   /*     Logical Maximum                              */ \
+    0x75, 0x08,          /*     Report Size (8)                              */ \
+    0x95, 0x02,          /*     Report Count (2)                             */ \
+    0x81, 0x82,          /*     Input (Data, Variable, Absolute, Volatile)   */ \
+    0xC0,                /*   End Collection                                 */ \
+                                                                            \
+    /* 8 game buttons. */                                                   \
+    0x05, 0x09,          /*   Usage Page (Button)                            */ \
+    0x19, 0x01,          /*   Usage Minimum (1)                              */ \
+    0x29, 0x08,          /*   Usage Maximum (8)                              */ \
+    0x15, 0x00,          /*   Logical Minimum (0)                            */ \
+    0x25, 0x01,          /*   Logical Maximum (1)                            */ \
+    0x75, 0x01,          /*   Report Size (1)                                */ \
+    0x95, 0x08,          /*   Report Count (8)                               */ \
+    0x81, 0x02,          /*   Input (Data, Variable, Absolute)               */ \
+                                                                            \
+    0xC0                 /* End Collection                                   */
+#endif
+
 const USB_Descriptor_HIDReport_Datatype_t PROGMEM Joystick_report_format[] =
 {
-    0x05, 0x01,          /* Usage Page (Generic Desktop)                     */
-    0x09, 0x04,          /* Usage (Joystick)                                 */
-
-    0xa1, 0x01,          /* Collection (Application)                         */
-    0x09, 0x01,          /*   Usage (Pointer)                                */
-
-    /* 2-axis joystick, treated as a D-pad. */
-    0xa1, 0x00,          /*   Collection (Physical)                          */
-    0x05, 0x01,          /*     Usage Page (Generic Desktop)                 */
-    0x09, 0x30,          /*     Usage (X)                                    */
-    0x09, 0x31,          /*     Usage (Y)                                    */
-    0x15, 0x00,          /*     Logical Minimum (0)                          */
-    0x25, 0x64,          /*     Logical Maximum (100)                        */
-    0x75, 0x08,          /*     Report Size (8)                              */
-    0x95, 0x02,          /*     Report Count (2)                             */
-    0x81, 0x82,          /*     Input (Data, Variable, Absolute, Volatile)   */
-    0xC0,                /*   End Collection                                 */
-
-    /* 8 game buttons. */
-    0x05, 0x09,          /*   Usage Page (Button)                            */
-    0x19, 0x01,          /*   Usage Minimum (1)                              */
-    0x29, 0x08,          /*   Usage Maximum (8)                              */
-    0x15, 0x00,          /*   Logical Minimum (0)                            */
-    0x25, 0x01,          /*   Logical Maximum (1)                            */
-    0x75, 0x01,          /*   Report Size (1)                                */
-    0x95, 0x08,          /*   Report Count (8)                               */
-    0x81, 0x02,          /*   Input (Data, Variable, Absolute)               */
+    JOYSTICK_COLLECTION,
+    JOYSTICK_INPUTS
+};
 
-    0xC0                 /* End Collection                                   */
+#if PLAYERS_PER_IF > 1
+/** HID class report descriptor for an interface shared by several players.
+ *
+ * Each player is its own joystick collection, with the player's report ID
+ * prefixed to its reports, so the host still sees one device per player.
+ */
+#define JOYSTICK_SHARED_COLLECTION(player_ix)                               \
+    JOYSTICK_COLLECTION,                                                    \
+    0x85, IF_REPORT_ID(player_ix), /*   Report ID                          */ \
+    JOYSTICK_INPUTS,
+
+const USB_Descriptor_HIDReport_Datatype_t PROGMEM Joystick_report_format_shared[] =
+{
+    REPEAT(PLAYERS_PER_IF, JOYSTICK_SHARED_COLLECTION)
 };
 
+#define IF_REPORT_FORMAT_SIZE(if_ix)                                        \
+    ((IF_PLAYERS(if_ix) > 1) ? sizeof(Joystick_report_format_shared) :    \
+                               sizeof(Joystick_report_format))
+#else
+#define IF_REPORT_FORMAT_SIZE(if_ix) sizeof(Joystick_report_format)
+#endif
+
 /** USB Vendor and Product Ids. */
 #define USB_VID_TEST_VID        0x03EB
 #define USB_PID_JOYSTICK_DEMO   0x2043
 
-/** USB descriptor string enums. */
+/** USB descriptor string enums.
+ *
+ * Interface strings follow the fixed strings, one per interface.
+ */
 typedef enum USB_descriptor_strings_e_ {
     USB_STR_LANGUAGE     = 0,
     USB_STR_MANUFACTURER,
     USB_STR_PRODUCT,
     USB_STR_SERIAL_NO,
-    USB_STR_IF_0,
-    USB_STR_IF_1,
-    USB_STR_IF_2,
-    USB_STR_IF_3,
-    USB_STR_NUM,
+    USB_STR_IF_FIRST,
+    USB_STR_NUM          = USB_STR_IF_FIRST + HID_IF_NUM,
 } USB_descriptor_strings_e;
 
 /** HID descriptor structure. */
@@ -161,6 +237,55 @@ const USB_Descriptor_Device_t PROGMEM Device_Descriptor =
     .NumberOfConfigurations = FIXED_NUM_CONFIGURATIONS
 };
 
+/** HID interface descriptors.
+ *
+ * Every HID interface is identical, apart from its interface number,
+ * string, endpoint and report descriptor size, so they are generated for
+ * each interface.
+ */
+#define HID_INTERFACE_DESCRIPTOR(if_ix)                                     \
+    .HID_Interface[if_ix] =                                                 \
+    {                                                                       \
+        .Interface =                                                        \
+        {                                                                   \
+            .Header                 = {.Size = sizeof(USB_Descriptor_Interface_t), \
+                                       .Type = DTYPE_Interface},            \
+                                                                            \
+            .InterfaceNumber        = (if_ix),                              \
+            .AlternateSetting       = 0x00,                                 \
+            .TotalEndpoints         = 1,                                    \
+            .Class                  = 0x03,                                 \
+            .SubClass               = 0x00,                                 \
+            .Protocol               = HID_CSCP_NonBootProtocol,             \
+            .InterfaceStrIndex      = USB_STR_IF_FIRST + (if_ix)            \
+        },                                                                  \
+                                                                            \
+        .HID =                                                              \
+        {                                                                   \
+            .Header                 = {.Size = sizeof(USB_HID_Descriptor_HID_t), \
+                                       .Type = HID_DTYPE_HID},              \
+                                                                            \
+            .HIDSpec                = VERSION_BCD(1, 11, 0),                \
+            .CountryCode            = 0x00,                                 \
+            .TotalReportDescriptors = 1,                                    \
+            .HIDReportType          = HID_DTYPE_Report,                     \
+            .HIDReportLength        = IF_REPORT_FORMAT_SIZE(if_ix)          \
+        },                                                                  \
+                                                                            \
+        .Endpoint =                                                         \
+        {                                                                   \
+            .Header                 = {.Size = sizeof(USB_Descriptor_Endpoint_t), \
+                                       .Type = DTYPE_Endpoint},             \
+                                                                            \
+            .EndpointAddress        = (ENDPOINT_DIR_IN | (IF_EP_FIRST + (if_ix))), \
+            .Attributes             = (EP_TYPE_INTERRUPT |                  \
+                                       ENDPOINT_ATTR_NO_SYNC |              \
+                                       ENDPOINT_USAGE_DATA),                \
+            .EndpointSize           = IF_EPSIZE,                            \
+            .PollingIntervalMS      = IF_POLLING_INTERVAL_MS                \
+        },                                                                  \
+    },
+
 /** Configuration descriptor structure.
  *
  * This descriptor, located in FLASH memory (PROGMEM), describes the usage
@@ -184,173 +309,7 @@ const USB_Descriptor_Configuration_t PROGMEM Configuration_Descriptor =
         .MaxPowerConsumption    = USB_CONFIG_POWER_MA(100)
     },
         
-    .HID_Interface[0] =
-    {
-        .Interface =
-        {
-            .Header                 = {.Size = sizeof(USB_Descriptor_Interface_t),
-                                       .Type = DTYPE_Interface},
-
-            .InterfaceNumber        = 0x00,
-            .AlternateSetting       = 0x00,
-            .TotalEndpoints         = 1,
-            .Class                  = 0x03,
-            .SubClass               = 0x00,
-            .Protocol               = HID_CSCP_NonBootProtocol,
-            .InterfaceStrIndex      = USB_STR_IF_0
-        },
-
-        .HID =
-        {
-            .Header                 = {.Size = sizeof(USB_HID_Descriptor_HID_t),
-                                       .Type = HID_DTYPE_HID},
-
-            .HIDSpec                = VERSION_BCD(1, 11, 0),
-            .CountryCode            = 0x00,
-            .TotalReportDescriptors = 1,
-            .HIDReportType          = HID_DTYPE_Report,
-            .HIDReportLength        = sizeof(Joystick_report_format)
-        },
-
-        .Endpoint =
-        {
-            .Header                 = {.Size = sizeof(USB_Descriptor_Endpoint_t),
-                                       .Type = DTYPE_Endpoint},
-
-            .EndpointAddress        = (ENDPOINT_DIR_IN | IF_EP_1),
-            .Attributes             = (EP_TYPE_INTERRUPT |
-                                       ENDPOINT_ATTR_NO_SYNC |
-                                       ENDPOINT_USAGE_DATA),
-            .EndpointSize           = IF_EPSIZE,
-            .PollingIntervalMS      = 0x02
-        },
-    },
-
-    .HID_Interface[1] =
-    {
-        .Interface =
-        {
-            .Header                 = {.Size = sizeof(USB_Descriptor_Interface_t),
-                                       .Type = DTYPE_Interface},
-
-            .InterfaceNumber        = 0x01,
-            .AlternateSetting       = 0x00,
-            .TotalEndpoints         = 1,
-            .Class                  = 0x03,
-            .SubClass               = 0x00,
-            .Protocol               = HID_CSCP_NonBootProtocol,
-            .InterfaceStrIndex      = USB_STR_IF_1
-        },
-
-        .HID =
-        {
-            .Header                 = {.Size = sizeof(USB_HID_Descriptor_HID_t),
-                                       .Type = HID_DTYPE_HID},
-
-            .HIDSpec                = VERSION_BCD(1, 11, 0),
-            .CountryCode            = 0x00,
-            .TotalReportDescriptors = 1,
-            .HIDReportType          = HID_DTYPE_Report,
-            .HIDReportLength        = sizeof(Joystick_report_format)
-        },
-
-        .Endpoint =
-        {
-            .Header                 = {.Size = sizeof(USB_Descriptor_Endpoint_t),
-                                       .Type = DTYPE_Endpoint},
-
-            .EndpointAddress        = (ENDPOINT_DIR_IN | IF_EP_2),
-            .Attributes             = (EP_TYPE_INTERRUPT |
-                                       ENDPOINT_ATTR_NO_SYNC |
-                                       ENDPOINT_USAGE_DATA),
-            .EndpointSize           = IF_EPSIZE,
-            .PollingIntervalMS      = 0x02
-        },
-    },
-
-    .HID_Interface[2] =
-    {
-        .Interface =
-        {
-            .Header                 = {.Size = sizeof(USB_Descriptor_Interface_t),
-                                       .Type = DTYPE_Interface},
-
-            .InterfaceNumber        = 0x02,
-            .AlternateSetting       = 0x00,
-            .TotalEndpoints         = 1,
-            .Class                  = 0x03,
-            .SubClass               = 0x00,
-            .Protocol               = HID_CSCP_NonBootProtocol,
-            .InterfaceStrIndex      = USB_STR_IF_2
-        },
-
-        .HID =
-        {
-            .Header                 = {.Size = sizeof(USB_HID_Descriptor_HID_t),
-                                       .Type = HID_DTYPE_HID},
-
-            .HIDSpec                = VERSION_BCD(1, 11, 0),
-            .CountryCode            = 0x00,
-            .TotalReportDescriptors = 1,
-            .HIDReportType          = HID_DTYPE_Report,
-            .HIDReportLength        = sizeof(Joystick_report_format)
-        },
-
-        .Endpoint =
-        {
-            .Header                 = {.Size = sizeof(USB_Descriptor_Endpoint_t),
-                                       .Type = DTYPE_Endpoint},
-
-            .EndpointAddress        = (ENDPOINT_DIR_IN | IF_EP_3),
-            .Attributes             = (EP_TYPE_INTERRUPT |
-                                       ENDPOINT_ATTR_NO_SYNC |
-                                       ENDPOINT_USAGE_DATA),
-            .EndpointSize           = IF_EPSIZE,
-            .PollingIntervalMS      = 0x02
-        },
-    },
-
-    .HID_Interface[3] =
-    {
-        .Interface =
-        {
-            .Header                 = {.Size = sizeof(USB_Descriptor_Interface_t),
-                                       .Type = DTYPE_Interface},
-
-            .InterfaceNumber        = 0x03,
-            .AlternateSetting       = 0x00,
-            .TotalEndpoints         = 1,
-            .Class                  = 0x03,
-            .SubClass               = 0x00,
-            .Protocol               = HID_CSCP_NonBootProtocol,
-            .InterfaceStrIndex      = USB_STR_IF_3
-        },
-
-        .HID =
-        {
-            .Header                 = {.Size = sizeof(USB_HID_Descriptor_HID_t),
-                                       .Type = HID_DTYPE_HID},
-
-            .HIDSpec                = VERSION_BCD(1, 11, 0),
-            .CountryCode            = 0x00,
-            .TotalReportDescriptors = 1,
-            .HIDReportType          = HID_DTYPE_Report,
-            .HIDReportLength        = sizeof(Joystick_report_format)
-        },
-
-        .Endpoint =
-        {
-            .Header                 = {.Size = sizeof(USB_Descriptor_Endpoint_t),
-                                       .Type = DTYPE_Endpoint},
-
-            .EndpointAddress        = (ENDPOINT_DIR_IN | IF_EP_4),
-            .Attributes             = (EP_TYPE_INTERRUPT |
-                                       ENDPOINT_ATTR_NO_SYNC |
-                                       ENDPOINT_USAGE_DATA),
-            .EndpointSize           = IF_EPSIZE,
-            .PollingIntervalMS      = 0x02
-        },
-    },
+    REPEAT(HID_IF_NUM, HID_INTERFACE_DESCRIPTOR)
 };
 
 /** Language descriptor structure.
@@ -407,32 +366,49 @@ const USB_Descriptor_String_t PROGMEM Serial_Number_String =
     .UnicodeString          = L"1337D00D"
 };
 
-/** Interface descriptor strings. */
-const USB_Descriptor_String_t Interface_Descriptor0 PROGMEM =
-{
-    .Header                 = {.Size = USB_STRING_LEN(8), .Type = DTYPE_String},
-    .UnicodeString          = L"Player 1"
-};
-
-const USB_Descriptor_String_t Interface_Descriptor1 PROGMEM =
-{
-    .Header                 = {.Size = USB_STRING_LEN(8),
-                               .Type = DTYPE_String},
-    .UnicodeString          = L"Player 2"
-};
-
-const USB_Descriptor_String_t Interface_Descriptor2 PROGMEM =
-{
-    .Header                 = {.Size = USB_STRING_LEN(8),
-                               .Type = DTYPE_String},
-    .UnicodeString          = L"Player 3"
-};
+/** Interface descriptor strings.
+ *
+ * One string per interface, generated like the interfaces: "Player N" for
+ * an interface with one player, or "Players N-M" for a shared interface.
+ * Both forms are held in the same characters, and the header size picks
+ * how many are sent.
+ */
+#define IF_STRING_SHARED(if_ix) (IF_PLAYERS(if_ix) > 1)
+#define IF_STRING_FIRST(if_ix)  ('1' + IF_FIRST_PLAYER(if_ix))
+#define IF_STRING_LAST(if_ix)   (IF_STRING_FIRST(if_ix) + IF_PLAYERS(if_ix) - 1)
+
+#define INTERFACE_STRING(if_ix)                                             \
+    const USB_Descriptor_String_t PROGMEM Interface_String##if_ix =         \
+    {                                                                       \
+        .Header                 = {.Size = IF_STRING_SHARED(if_ix) ?        \
+                                           USB_STRING_LEN(11) :             \
+                                           USB_STRING_LEN(8),               \
+                                   .Type = DTYPE_String},                   \
+        .UnicodeString          = {'P', 'l', 'a', 'y', 'e', 'r',            \
+                                   IF_STRING_SHARED(if_ix) ? 's' : ' ',     \
+                                   IF_STRING_SHARED(if_ix) ? ' ' :          \
+                                                             IF_STRING_FIRST(if_ix), \
+                                   IF_STRING_FIRST(if_ix), '-',             \
+                                   IF_STRING_LAST(if_ix)}                   \
+    };
+
+REPEAT(HID_IF_NUM, INTERFACE_STRING)
+
+/** String descriptor table.
+ *
+ * Indexed by string number, so a string is found in constant time. Each
+ * string's size is read from its own header.
+ */
+#define INTERFACE_STRING_ENTRY(if_ix)                                       \
+    [USB_STR_IF_FIRST + (if_ix)] = &Interface_String##if_ix,
 
-const USB_Descriptor_String_t Interface_Descriptor3 PROGMEM =
+static const USB_Descriptor_String_t* const PROGMEM String_Descriptors[USB_STR_NUM] =
 {
-    .Header                 = {.Size = USB_STRING_LEN(8),
-                               .Type = DTYPE_String},
-    .UnicodeString          = L"Player 4"
+    [USB_STR_LANGUAGE]     = &Language_String,
+    [USB_STR_MANUFACTURER] = &Manufacturer_String,
+    [USB_STR_PRODUCT]      = &Product_String,
+    [USB_STR_SERIAL_NO]    = &Serial_Number_String,
+    REPEAT(HID_IF_NUM, INTERFACE_STRING_ENTRY)
 };
 
 /** Descriptor retrieval API.
@@ -465,55 +441,29 @@ uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue,
         size    = sizeof(USB_Descriptor_Configuration_t);
         break;
     case DTYPE_String:
-        switch (descriptor_number) {
-        case USB_STR_LANGUAGE:
-            address = (void*)&Language_String;
-            size    = pgm_read_byte(&Language_String.Header.Size);
-            break;
-        case USB_STR_MANUFACTURER:
-            address = (void*)&Manufacturer_String;
-            size    = pgm_read_byte(&Manufacturer_String.Header.Size);
-            break;
-        case USB_STR_PRODUCT:
-            address = (void*)&Product_String;
-            size    = pgm_read_byte(&Product_String.Header.Size);
-            break;
-        case USB_STR_SERIAL_NO:
-            address = (void*)&Serial_Number_String;
-            size = pgm_read_byte(&Serial_Number_String.Header.Size);
-            break;
-        case USB_STR_IF_0:
-            address = (void*)&Interface_Descriptor0;
-            size = pgm_read_byte(&Interface_Descriptor0.Header.Size);
-            break;
-        case USB_STR_IF_1:
-            address = (void*)&Interface_Descriptor1;
-            size = pgm_read_byte(&Interface_Descriptor1.Header.Size);
-            break;
-        case USB_STR_IF_2:
-            address = (void*)&Interface_Descriptor2;
-            size = pgm_read_byte(&Interface_Descriptor2.Header.Size);
-            break;
-        case USB_STR_IF_3:
-            address = (void*)&Interface_Descriptor3;
-            size = pgm_read_byte(&Interface_Descriptor3.Header.Size);
-            break;
-        default:
-            break;
+        if (descriptor_number < USB_STR_NUM) {
+            const USB_Descriptor_String_t* string =
+                pgm_read_ptr(&String_Descriptors[descriptor_number]);
+
+            address = (void*)string;
+            size    = pgm_read_byte(&string->Header.Size);
         }
         break;
     case HID_DTYPE_HID:
-        if (wIndex < HID_IF_NUM) {
-            address = (void*)&Configuration_Descriptor.HID_Interface[wIndex];
-            size    = sizeof(USB_HID_Descriptor_HID_t);
-        } else {
-            address = (void*)&Configuration_Descriptor.HID_Interface[0];
-            size    = sizeof(USB_HID_Descriptor_HID_t);
-        }
-
+        /* An unknown interface gets the first interface's descriptor. */
+        address = (void*)&Configuration_Descriptor.HID_Interface[
+                      (wIndex < HID_IF_NUM) ? wIndex : 0].HID;
+        size    = sizeof(USB_HID_Descriptor_HID_t);
         break;
     case HID_DTYPE_Report:
-        /* All reports are the same size, so no need to use wIndex. */
+#if PLAYERS_PER_IF > 1
+        if ((wIndex < HID_IF_NUM) && (IF_PLAYERS(wIndex) > 1)) {
+            address = (void*)&Joystick_report_format_shared;
+            size    = sizeof(Joystick_report_format_shared);
+            break;
+        }
+#endif
+        /* Interfaces with one player share the single-player format. */
         address = (void*)&Joystick_report_format;
         size    = sizeof(Joystick_report_format);
         break;
@@ -63,6 +63,9 @@
 #include <LUFA/Drivers/USB/USB.h>
 #include <LUFA/Drivers/USB/Class/HIDClass.h>
 
+#include "players.h"
+#include "serial_link.h"
+
 
 /* Type Defines: */
 
@@ -79,9 +82,50 @@ typedef enum USB_if_endpoint_e_ {
 
 /* Macros: */
 
+/** Number of HID interfaces, and players per interface (see players.h).
+ *
+ * The 16U2 has four endpoints besides the control endpoint, so up to four
+ * players get an interface each. Beyond that, players are paired on each
+ * interface, in player order, and each player of a pair is reported as
+ * its own top-level collection with its own report ID. With an odd number
+ * of players the last interface carries a single player, without a
+ * report ID. HID_IF_NUM must be a plain number, for REPEAT().
+ */
+#if PLAYER_NUM <= 4
+#define PLAYERS_PER_IF 1
+#define HID_IF_NUM PLAYER_NUM
+#elif PLAYER_NUM <= 6
+#define PLAYERS_PER_IF 2
+#define HID_IF_NUM 3
+#else
+#define PLAYERS_PER_IF 2
+#define HID_IF_NUM 4
+#endif
+
+/** First player, and number of players, carried by an interface. */
+#define IF_FIRST_PLAYER(if_ix) ((if_ix) * PLAYERS_PER_IF)
+#define IF_PLAYERS(if_ix)                                                 \
+    (((PLAYER_NUM - IF_FIRST_PLAYER(if_ix)) < PLAYERS_PER_IF) ?           \
+     (PLAYER_NUM - IF_FIRST_PLAYER(if_ix)) : PLAYERS_PER_IF)
+
+/** Report ID of a player on a shared interface. Report ID 0 is reserved,
+ * and means a report without an ID.
+ */
+#define IF_REPORT_ID(player_ix) (((player_ix) % PLAYERS_PER_IF) + 1)
+
 /** Size in bytes of each interface HID reporting IN endpoint. */
 #define IF_EPSIZE 8
 
+/** Polling interval in milliseconds of each interface IN endpoint.
+ *
+ * The low-latency mode asks the host to poll every frame.
+ */
+#ifdef LOW_LATENCY_MODE
+#define IF_POLLING_INTERVAL_MS 0x01
+#else
+#define IF_POLLING_INTERVAL_MS 0x02
+#endif
+
 
 /* Function Prototypes: */
 
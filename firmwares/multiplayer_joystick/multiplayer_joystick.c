@@ -80,32 +80,181 @@
 #include "multiplayer_joystick.h"
 
 
-/** Synchronization */
-#define SYNC_BYTE       0xFF
-#define SYNC_BYTE_NUM   3
-static uint8_t sync_bytes;
+/** Serial link receive queue.
+ *
+ * A single-producer, single-consumer byte queue: the USART receive
+ * interrupt only ever writes link_rx_head, and the main loop only ever
+ * writes link_rx_tail, so neither side needs to disable interrupts. The
+ * size must be a power of two.
+ */
+#define LINK_RX_QUEUE_SIZE  64
+static uint8_t link_rx_queue[LINK_RX_QUEUE_SIZE];
+static volatile uint8_t link_rx_head;
+static volatile uint8_t link_rx_tail;
+static volatile uint16_t link_rx_overflows;
+static volatile uint8_t link_uart_errors;
+
+/** USART receive errors by status flag, counted by the receive interrupt
+ * (see Vendor_link_stats_t).
+ */
+typedef struct Link_uart_stats_t_ {
+    uint16_t frame_errors;
+    uint16_t overruns;
+    uint16_t parity_errors;
+} Link_uart_stats_t;
+static volatile Link_uart_stats_t link_uart_stats;
+
+/** Serial link frame decoder, run from the main loop. */
+static link_decoder_t link_decoder;
+
+/** Serial link rate negotiation state.
+ *
+ * Rate requests and errors are collected as frames are decoded; the link
+ * task acknowledges requests, switches rates and sends the periodic status
+ * frame. Timing uses Timer1, free-running at F_CPU/64.
+ */
+#define LINK_TIMER_TICKS_PER_MS     (F_CPU / 64 / 1000)
+static uint8_t link_rate;
+static uint8_t link_rate_request;
+static uint8_t link_frame_errors;
+static uint8_t link_uart_errors_seen;
+static uint16_t link_heartbeat_time;
+static uint16_t link_resyncs;
+
+/** Frame decoder counters, copied by link_rx_task() with interrupts
+ * disabled, so the stats request can read them from the USB interrupt
+ * without catching one half updated.
+ */
+typedef struct Link_rx_stats_t_ {
+    uint16_t frames;
+    uint16_t crc_errors;
+    uint16_t framing_errors;
+    uint16_t lost_frames;
+    uint16_t resyncs;
+} Link_rx_stats_t;
+static Link_rx_stats_t link_rx_stats;
+
+/** Main loop activity.
+ *
+ * The main loop sleeps in idle mode whenever no interrupt has left it
+ * work. The Timer1 ticks it spends asleep are added up, and at each
+ * heartbeat turned into the fraction of the heartbeat period it was
+ * awake, in thousandths.
+ */
+static uint16_t sleep_ticks;
+static volatile uint16_t active_permille;
 
-/** Circular buffer to hold data from the serial port before it is sent to
- * the host.
+/** Runtime settings (see serial_link.h).
+ *
+ * The settings are stored in EEPROM followed by their CRC-8, and replaced
+ * by the defaults if the stored copy is missing, corrupt or of another
+ * version. settings_due is set when the Mega should be sent them, and
+ * idle_default caches the idle rate they select. Control requests replace
+ * them from the USB interrupt, and leave settings_store_due for the main
+ * loop to write the EEPROM.
  */
-static RingBuffer_t usart_to_usb_buffer;
+#define SETTINGS_EEPROM_ADDR    ((void *)0)
+static link_settings_t settings;
+static volatile bool settings_due;
+static volatile bool settings_store_due;
+static uint16_t idle_default;
 
 /** Joystick report storage.
  *
  * The structure modeling the HID Joystick report for storing and sending to
  * the host PC. This mirrors the layout described to the host in the HID
- * report descriptor, in descriptors.c.
+ * report descriptor, in descriptors.c. The compact report replaces the
+ * axes with a hat switch, packed with the buttons (see serial_link.h).
  */
+#if COMPACT_REPORT
 typedef struct __attribute__((__packed__)) USB_joystick_report_data_t_ {
-    int8_t axis[AXIS_NUM]; /* Array of joystick axes */
+    uint8_t hat_buttons[2]; /* Hat in bits 0-3, buttons in bits 4-11 */
+} USB_joystick_report_data_t;
+#else
+typedef struct __attribute__((__packed__)) USB_joystick_report_data_t_ {
+    uint8_t axis[AXIS_NUM]; /* Array of joystick axes */
     uint8_t buttons;       /* Bit mask of the currently pressed buttons */
 } USB_joystick_report_data_t;
+#endif
 
 #define JOYSTICK_REPORT_BUFFER_SIZE    (sizeof(USB_joystick_report_data_t) * \
-                                        HID_IF_NUM)
-static uint8_t joystick_report_buffer[JOYSTICK_REPORT_BUFFER_SIZE];
+                                        PLAYER_NUM)
+
+#if (COMPACT_REPORT && (LINK_PLAYER_STATE_SIZE != 2)) || \
+    (!COMPACT_REPORT && (LINK_PLAYER_STATE_SIZE != 3))
+#error "Serial link player state does not match the joystick report"
+#endif
+
+/** Published report buffers.
+ *
+ * Reports from the serial link are assembled in a private buffer and only
+ * published once a whole frame has been validated, by storing the new
+ * buffer's index in report_front. The report reader claims the front
+ * buffer by copying its index to report_reader, and the frame decoder
+ * never writes to the front or the claimed buffer. Three buffers are
+ * enough for the decoder to always find a free one, so a report can never
+ * be read while it is being written, and no interrupts need to be
+ * disabled, whichever side runs in interrupt context.
+ */
+#define REPORT_BUFFER_NUM   3
+static uint8_t joystick_report_buffers[REPORT_BUFFER_NUM]
+                                      [JOYSTICK_REPORT_BUFFER_SIZE];
+static volatile uint8_t report_front;
+static volatile uint8_t report_reader;
+
+/** Set when interface_report() has work: a report was published, or a
+ * frame started, so an idle deadline may have passed or an endpoint's bank
+ * been collected. Not used in low-latency mode, where the start of frame
+ * event runs the report task itself.
+ */
+static volatile bool report_due;
+
+/** Report age statistics.
+ *
+ * Each published buffer is timestamped, and the age of a changed report is
+ * recorded when it is written to its endpoint. In low-latency mode that is
+ * the slack between the report arriving and the start of frame at which it
+ * is submitted. Times are in Timer1 ticks of 4 microseconds.
+ */
+static uint16_t report_time[REPORT_BUFFER_NUM];
+typedef struct Report_age_t_ {
+    uint16_t last;
+    uint16_t max;
+    uint32_t total;
+    uint16_t count;
+} Report_age_t;
+static Report_age_t Report_age;
+
 static uint8_t prev_joystick_report_buffer[JOYSTICK_REPORT_BUFFER_SIZE];
 
+/** Report queues.
+ *
+ * As each frame is published, every player whose report changed has the
+ * new report queued, in order, for its interface's endpoint; the previous
+ * report buffer holds the last report queued for each player, to compare
+ * against. The endpoints are double banked, so the report task can hand
+ * the next queued report to the second bank while the host collects the
+ * first, and a state that lasts less than a polling interval still
+ * reaches the host, followed by the one that replaced it.
+ *
+ * When a player's queue is full, a new report replaces the newest one
+ * queued, so a backlog never grows past REPORT_QUEUE_LEN reports and the
+ * last report queued is always the current one. The queue is written by
+ * the frame decoder and read by the report task, which may run in the
+ * start of frame event, so writes are made with interrupts disabled.
+ * REPORT_QUEUE_LEN must be a power of two.
+ */
+#ifndef REPORT_QUEUE_LEN
+#define REPORT_QUEUE_LEN    4
+#endif
+typedef struct Report_queue_t_ {
+    uint8_t          reports[REPORT_QUEUE_LEN]
+                            [sizeof(USB_joystick_report_data_t)];
+    volatile uint8_t head;  /* Free-running, masked to index reports */
+    volatile uint8_t tail;
+} Report_queue_t;
+static Report_queue_t Report_queue[PLAYER_NUM];
+
 /** Endpoint state structure.
  *
  * A structure for recording the state of an HID interface endpoint.
@@ -113,16 +262,89 @@ static uint8_t prev_joystick_report_buffer[JOYSTICK_REPORT_BUFFER_SIZE];
  * an endpoint has been last updated. In actuality however, all endpoints
  * will likely send their reports at the same time.
  *
- * The default timeout is 1000 milliseconds.
+ * The transfer counters record how the endpoint's bus time is used: reports
+ * actually sent, host polls the hardware answered with a NAK, and of those,
+ * the polls that arrived while there was nothing new to send. The latter
+ * would have collected an empty packet before endpoints were only armed
+ * when a report is written.
+ *
+ * An interface shared by several players sends one player's report at a
+ * time. The players due a report, with one queued or after an idle
+ * timeout, are served in turn, starting after the one last sent.
+ *
+ * Each player's report has its own idle rate, as the host sets it per
+ * report ID, in frames; 0 is infinite, so the report is only sent when it
+ * changes. Once its idle rate has passed since it was last sent, the
+ * report is due again. The idle deadlines are kept against the frame
+ * count, and each endpoint caches its earliest one, so the start of frame
+ * event does a single increment, and a pass that is not at a deadline
+ * does one comparison per endpoint.
+ *
+ * The idle rate is 1000 milliseconds until the host sets one, unless the
+ * settings select another.
  */
 #define IDLE_TIMEOUT_DEFAULT    0x03E8
 typedef struct Endpoint_state_t_ {
     USB_if_endpoint_e ep_num;
-    uint16_t          idle_timeout;
-    uint16_t          idle_count;
+    uint8_t           first_player;
+    uint8_t           players;
+    uint8_t           next_slot;  /* Player, within the interface, served next */
+    uint8_t           resend;     /* Players due a report by idle timeout */
+    uint16_t          idle_rate[PLAYERS_PER_IF]; /* Frames, 0 for infinite */
+    uint16_t          idle_last[PLAYERS_PER_IF]; /* Frame last sent */
+    uint16_t          idle_next;  /* Earliest deadline, when idle_armed */
+    bool              idle_armed;
+    bool              nothing_to_send;
+    uint16_t          reports_sent;
+    uint16_t          idle_resends;
+    uint16_t          reports_coalesced; /* Queued reports replaced */
+    uint16_t          naked_polls;
+    uint16_t          empty_polls_avoided;
 } Endpoint_state_t;
 static Endpoint_state_t Ep_state[HID_IF_NUM];
 
+/** USB frames, counted by the start of frame event. */
+static volatile uint16_t usb_frame;
+
+
+/** Take up a new set of settings: derive the 16U2's own, and have the
+ * Mega's forwarded by link_task().
+ */
+static void settings_apply(const link_settings_t *new_settings)
+{
+    settings = *new_settings;
+    idle_default = (settings.idle_ms != LINK_SETTING_DEFAULT16) ?
+                   settings.idle_ms : IDLE_TIMEOUT_DEFAULT;
+    settings_due = true;
+}
+
+/** Load the settings from EEPROM, or the defaults. */
+static void settings_load(void)
+{
+    uint8_t block[sizeof(link_settings_t) + LINK_CRC_SIZE];
+    link_settings_t stored;
+
+    eeprom_read_block(block, SETTINGS_EEPROM_ADDR, sizeof(block));
+    memcpy(&stored, block, sizeof(stored));
+
+    if ((link_crc8(block, sizeof(block)) != 0) ||
+        !link_settings_valid(&stored)) {
+        link_settings_default(&stored);
+    }
+    settings_apply(&stored);
+}
+
+/** Store the settings in EEPROM. Only bytes that differ are written. */
+static void settings_store(void)
+{
+    uint8_t block[sizeof(link_settings_t) + LINK_CRC_SIZE];
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        memcpy(block, &settings, sizeof(settings));
+    }
+    block[sizeof(settings)] = link_crc8(block, sizeof(settings));
+    eeprom_update_block(block, SETTINGS_EEPROM_ADDR, sizeof(block));
+}
 
 /** Configures the board hardware and chip peripherals. */
 static void setup_hardware(void)
@@ -132,117 +354,681 @@ static void setup_hardware(void)
     wdt_disable();
 
     /* Hardware Initialization */
-    Serial_Init(115200, true);
+    Serial_Init(link_rate_baud[LINK_RATE_SAFE], true);
 #ifdef LEDS_ENABLE
     LEDs_Init();
 #endif
     USB_Init();
 
     UCSR1B = ((1 << RXCIE1) | (1 << TXEN1) | (1 << RXEN1));
+
+    /* Free-running link timer, whose compare match wakes the main loop
+     * for the heartbeat.
+     */
+    TCCR1A = 0;
+    TCCR1B = ((1 << CS11) | (1 << CS10));
+    OCR1A = LINK_HEARTBEAT_MS * LINK_TIMER_TICKS_PER_MS;
+    TIMSK1 = (1 << OCIE1A);
+
+    set_sleep_mode(SLEEP_MODE_IDLE);
 }
 
-/** Retrieve the part of the report buffer belonging to the given interface. */
-static void select_report(int if_ix, uint8_t **report, uint8_t **prev_report)
+/** Read the free-running Timer1 count.
+ *
+ * The 16-bit read shares the timer's TEMP register with any interrupt that
+ * reads the timer, so it is made atomic.
+ */
+static uint16_t timer_now(void)
 {
-    if (if_ix >= HID_IF_NUM) {
-        /* Not a valid interface index. Return the first interface. */
-        if_ix = 0;
+    uint16_t now;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        now = TCNT1;
     }
+    return now;
+}
 
-    *report =
-        &joystick_report_buffer[sizeof(USB_joystick_report_data_t) * if_ix];
+/** Encode and transmit a frame on the serial link. */
+static void link_send_frame(uint8_t type, const uint8_t *payload, uint8_t len)
+{
+    static uint8_t link_seq;
+    uint8_t buffer[LINK_ENCODED_MAX];
+    uint8_t frame_len;
+
+    frame_len = link_frame_encode(type, link_seq++, payload, len, buffer);
+
+    /* Clear the transmit-complete flag, so a rate switch can wait on it. */
+    UCSR1A = ((UCSR1A & (1 << U2X1)) | (1 << TXC1));
+
+    for (uint8_t ix = 0; ix < frame_len; ix++) {
+        Serial_SendByte(buffer[ix]);
+    }
+}
+
+/** Switch the serial link to a new rate.
+ *
+ * Any byte still being shifted out is allowed to finish first.
+ */
+static void link_set_rate(uint8_t rate)
+{
+    while ((UCSR1B & (1 << TXEN1)) && !(UCSR1A & (1 << TXC1))) {
+    }
+
+    Serial_Init(link_rate_baud[rate], true);
+    UCSR1B = ((1 << RXCIE1) | (1 << TXEN1) | (1 << RXEN1));
+    link_rate = rate;
+    link_frame_errors = 0;
+    link_uart_errors_seen = link_uart_errors;
+}
+
+/** Find a report buffer that is neither published nor claimed. */
+static uint8_t *report_back_buffer(uint8_t *back_ix)
+{
+    uint8_t front = report_front;
+    uint8_t reader = report_reader;
+    uint8_t ix = 0;
+
+    while ((ix == front) || (ix == reader)) {
+        ix++;
+    }
+
+    *back_ix = ix;
+    return joystick_report_buffers[ix];
+}
+
+/** Retrieve the part of the report buffer belonging to the given player. */
+static void select_report(uint8_t *reports, int player_ix,
+                          uint8_t **report, uint8_t **prev_report)
+{
+    if (player_ix >= PLAYER_NUM) {
+        /* Not a valid player index. Return the first player. */
+        player_ix = 0;
+    }
+
+    *report = &reports[sizeof(USB_joystick_report_data_t) * player_ix];
     *prev_report =
         &prev_joystick_report_buffer[sizeof(USB_joystick_report_data_t) *
-                                     if_ix];
+                                     player_ix];
+}
+
+/** Queue the report of every player whose report changed in a newly
+ * published buffer.
+ */
+static void report_queue_changes(uint8_t *reports)
+{
+    uint8_t report_size = sizeof(USB_joystick_report_data_t);
+    uint8_t *report, *prev_report;
+
+    for (uint8_t player_ix = 0; player_ix < PLAYER_NUM; player_ix++) {
+        Report_queue_t *queue = &Report_queue[player_ix];
+
+        select_report(reports, player_ix, &report, &prev_report);
+        if (memcmp(prev_report, report, report_size) == 0) {
+            continue;
+        }
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            uint8_t head = queue->head;
+
+            if ((uint8_t)(head - queue->tail) == REPORT_QUEUE_LEN) {
+                /* Full: replace the newest report. */
+                head--;
+                Ep_state[player_ix / PLAYERS_PER_IF].reports_coalesced++;
+            } else {
+                queue->head = head + 1;
+            }
+            memcpy(queue->reports[head & (REPORT_QUEUE_LEN - 1)], report,
+                   report_size);
+            memcpy(prev_report, report, report_size);
+        }
+    }
+}
+
+/** Publish a back buffer of new reports, and queue the changes. */
+static void report_publish(uint8_t back_ix)
+{
+    report_time[back_ix] = timer_now();
+    report_front = back_ix;
+    report_queue_changes(joystick_report_buffers[back_ix]);
+#ifndef LOW_LATENCY_MODE
+    report_due = true;
+#endif
+}
+
+/** Check that a delta frame payload is well formed. */
+static bool link_delta_valid(const uint8_t *payload, uint8_t payload_len)
+{
+    if ((payload_len == 0) || (payload_len % LINK_DELTA_RECORD_SIZE)) {
+        return false;
+    }
+
+    for (; payload_len; payload_len -= LINK_DELTA_RECORD_SIZE,
+                        payload += LINK_DELTA_RECORD_SIZE) {
+        if (LINK_DELTA_PLAYER(payload) >= PLAYER_NUM) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Apply a frame from the serial link to the report buffers.
+ *
+ * A state frame replaces the reports of all players. A delta frame holds
+ * records of a player index and its state, and each record replaces that
+ * player's slice of the current reports. Either way the
+ * new reports are assembled in a back buffer, then published. Compact
+ * states are unpacked into their reports (see serial_link.h).
+ */
+static void link_frame_receive(uint8_t type, const uint8_t *payload,
+                               uint8_t payload_len)
+{
+    uint8_t *back;
+    uint8_t back_ix;
+
+    switch (type) {
+    case LINK_FRAME_STATE:
+        if (payload_len == LINK_STATE_PAYLOAD_SIZE(PLAYER_NUM)) {
+            back = report_back_buffer(&back_ix);
+#if COMPACT_REPORT
+            for (uint8_t player_ix = 0; player_ix < PLAYER_NUM; player_ix++) {
+                link_states_unpack(payload, player_ix,
+                                   &back[sizeof(USB_joystick_report_data_t) *
+                                         player_ix]);
+            }
+#else
+            memcpy(back, payload, JOYSTICK_REPORT_BUFFER_SIZE);
+#endif
+            report_publish(back_ix);
+        }
+        break;
+    case LINK_FRAME_DELTA:
+        if (link_delta_valid(payload, payload_len)) {
+            back = report_back_buffer(&back_ix);
+            memcpy(back, joystick_report_buffers[report_front],
+                   JOYSTICK_REPORT_BUFFER_SIZE);
+
+            for (; payload_len; payload_len -= LINK_DELTA_RECORD_SIZE,
+                                payload += LINK_DELTA_RECORD_SIZE) {
+                uint8_t *report = &back[sizeof(USB_joystick_report_data_t) *
+                                        LINK_DELTA_PLAYER(payload)];
+#if COMPACT_REPORT
+                report[0] = payload[0];
+                report[1] = payload[1] & 0x0F;
+#else
+                memcpy(report, &payload[1], sizeof(USB_joystick_report_data_t));
+#endif
+            }
+            report_publish(back_ix);
+        }
+        break;
+    case LINK_FRAME_RATE_REQUEST:
+        if ((payload_len == 1) && (payload[0] < LINK_RATE_NUM)) {
+            /* Acknowledged and applied by link_task(). */
+            link_rate_request = payload[0];
+        }
+        break;
+    case LINK_FRAME_SETTINGS_REQUEST:
+        /* Sent by link_task(). */
+        settings_due = true;
+        break;
+    default:
+        break;
+    }
+}
+
+/** Serial link receive task.
+ *
+ * Drains the receive queue through the frame decoder, applying each valid
+ * frame as it completes.
+ */
+static void link_rx_task(void)
+{
+    uint8_t tail = link_rx_tail;
+
+    if (tail == link_rx_head) {
+        return;
+    }
+
+    while (tail != link_rx_head) {
+        uint8_t rx_byte = link_rx_queue[tail];
+        uint8_t frame_len;
+
+        tail = (tail + 1) & (LINK_RX_QUEUE_SIZE - 1);
+        link_rx_tail = tail;
+
+        frame_len = link_decoder_push(&link_decoder, rx_byte);
+
+        if ((frame_len == 0) && (rx_byte == LINK_DELIMITER)) {
+            /* The delimiter closed a corrupted frame. */
+            link_frame_errors++;
+            link_resyncs++;
+        } else if (frame_len != 0) {
+            link_frame_receive(LINK_FRAME_TYPE(&link_decoder),
+                               LINK_FRAME_PAYLOAD(&link_decoder),
+                               LINK_FRAME_PAYLOAD_LEN(frame_len));
+        }
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        link_rx_stats.frames = link_decoder.frames;
+        link_rx_stats.crc_errors = link_decoder.crc_errors;
+        link_rx_stats.framing_errors = link_decoder.framing_errors;
+        link_rx_stats.lost_frames = link_decoder.lost_frames;
+        link_rx_stats.resyncs = link_resyncs;
+    }
+}
+
+/** Serial link task.
+ *
+ * Acknowledges rate requests from the Mega, falls back to the safe rate
+ * when the receive error count exceeds the limit, sends the settings when
+ * due and stores them once changed, and sends the status heartbeat.
+ */
+static void link_task(void)
+{
+    uint8_t rate_request = link_rate_request;
+
+    if (rate_request < LINK_RATE_NUM) {
+        link_rate_request = LINK_RATE_NUM;
+
+        /* Acknowledge at the old rate, then switch. */
+        link_send_frame(LINK_FRAME_RATE_ACK, &rate_request, 1);
+        link_set_rate(rate_request);
+    }
+
+    if (settings_due) {
+        link_settings_t current;
+
+        settings_due = false;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            current = settings;
+        }
+        link_send_frame(LINK_FRAME_SETTINGS, (const uint8_t *)&current,
+                        sizeof(current));
+    }
+
+    if (settings_store_due) {
+        settings_store_due = false;
+        settings_store();
+    }
+
+    uint16_t now = timer_now();
+    uint16_t period = now - link_heartbeat_time;
+
+    if (period >= (LINK_HEARTBEAT_MS * LINK_TIMER_TICKS_PER_MS)) {
+        uint8_t uart_errors = link_uart_errors;
+        uint8_t errors = (uint8_t)(uart_errors - link_uart_errors_seen) +
+                         link_frame_errors;
+        uint16_t asleep = (sleep_ticks < period) ? sleep_ticks : period;
+        uint16_t active = (uint32_t)(period - asleep) * 1000 / period;
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            active_permille = active;
+            OCR1A = now + (LINK_HEARTBEAT_MS * LINK_TIMER_TICKS_PER_MS);
+        }
+        sleep_ticks = 0;
+
+        link_heartbeat_time = now;
+        link_uart_errors_seen = uart_errors;
+        link_frame_errors = 0;
+
+        if ((link_rate != LINK_RATE_SAFE) && (errors >= LINK_ERROR_LIMIT)) {
+            link_set_rate(LINK_RATE_SAFE);
+        }
+
+        link_send_frame(LINK_FRAME_STATUS, &link_rate, 1);
+    }
+}
+
+/** Claim the most recently published report buffer.
+ *
+ * The claim is retried if a new buffer was published while it was being
+ * made, so the returned buffer is both current and protected from the
+ * frame decoder until the next claim.
+ */
+static uint8_t *claim_reports(void)
+{
+    uint8_t front;
+
+    do {
+        front = report_front;
+        report_reader = front;
+    } while (report_front != front);
+
+    return joystick_report_buffers[front];
+}
+
+/** Record the age of a report as it is submitted. */
+static void record_report_age(uint16_t published)
+{
+    uint16_t age = timer_now() - published;
+
+    Report_age.last = age;
+    if (age > Report_age.max) {
+        Report_age.max = age;
+    }
+    Report_age.total += age;
+    Report_age.count++;
+}
+
+/** Read the frame count, which the start of frame event advances. */
+static uint16_t usb_frame_now(void)
+{
+    uint16_t frame;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        frame = usb_frame;
+    }
+    return frame;
+}
+
+/** Find an endpoint's earliest idle deadline, among the players with an
+ * idle rate that are not already due a report. The deadlines are worked
+ * out from the time since each report was sent, so they stay in order
+ * across the frame count wrapping.
+ */
+static void idle_schedule(Endpoint_state_t *ep_ptr, uint16_t now)
+{
+    uint16_t wait = 0;
+
+    ep_ptr->idle_armed = false;
+    for (uint8_t slot = 0; slot < ep_ptr->players; slot++) {
+        uint16_t rate = ep_ptr->idle_rate[slot];
+        uint16_t elapsed = now - ep_ptr->idle_last[slot];
+        uint16_t left = (elapsed < rate) ? rate - elapsed : 0;
+
+        if (!rate || (ep_ptr->resend & (1 << slot))) {
+            continue;
+        }
+        if (!ep_ptr->idle_armed || (left < wait)) {
+            wait = left;
+            ep_ptr->idle_armed = true;
+        }
+    }
+    ep_ptr->idle_next = now + wait;
 }
 
-/** Per-interface report task. */
+/** Mark the players whose idle rate has passed since their last report
+ * as due a report, once the endpoint's earliest deadline is reached.
+ */
+static void idle_check(Endpoint_state_t *ep_ptr, uint16_t now)
+{
+    if (!ep_ptr->idle_armed || ((int16_t)(now - ep_ptr->idle_next) < 0)) {
+        return;
+    }
+    for (uint8_t slot = 0; slot < ep_ptr->players; slot++) {
+        uint16_t rate = ep_ptr->idle_rate[slot];
+
+        if (rate && ((uint16_t)(now - ep_ptr->idle_last[slot]) >= rate)) {
+            ep_ptr->resend |= (uint8_t)(1 << slot);
+        }
+    }
+    idle_schedule(ep_ptr, now);
+}
+
+/** Set the idle rate of one report, or of all the interface's reports for
+ * report ID 0. As the HID specification asks, a report whose new rate
+ * has already passed since it was last sent is due at once.
+ */
+static void idle_set(Endpoint_state_t *ep_ptr, uint8_t report_id,
+                     uint16_t rate)
+{
+    uint16_t now = usb_frame_now();
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        for (uint8_t slot = 0; slot < ep_ptr->players; slot++) {
+            if ((report_id == 0) || (report_id == slot + 1)) {
+                ep_ptr->idle_rate[slot] = rate;
+            }
+        }
+        ep_ptr->resend = 0;
+        idle_schedule(ep_ptr, now);
+        idle_check(ep_ptr, now);
+    }
+}
+
+/** Per-interface report task.
+ *
+ * Runs from the main loop when report_due is set, or from the start of
+ * frame event in low-latency mode, so that the newest report is submitted
+ * just before the host polls.
+ *
+ * Control requests change the idle state from the USB interrupt, which
+ * LUFA runs with interrupts enabled, so the task only touches it with
+ * interrupts disabled.
+ */
 static void interface_report(void)
 {
     uint16_t report_size = sizeof(USB_joystick_report_data_t);
+    uint16_t published, now;
+    bool aged = false;
 
     /* Device must be connected and configured for the task to run. */
     if (USB_DeviceState != DEVICE_STATE_Configured) {
         return;
     }
 
+    published = report_time[report_front];
+    now = usb_frame_now();
+
     /* Update reports for all interfaces. */
     for (int if_ix = 0; if_ix < HID_IF_NUM; if_ix++) {
         Endpoint_state_t *ep_ptr = &Ep_state[if_ix];
-        bool idle_expiry = false;
-        uint8_t *report, *prev_report;
 
         /* Select the Report Endpoint. */
         Endpoint_SelectEndpoint(ENDPOINT_DIR_IN | ep_ptr->ep_num);
 
-        /* Check if idle timer defined by HOST has elapsed. */
-        if ((ep_ptr->idle_timeout &&
-             (ep_ptr->idle_count >= ep_ptr->idle_timeout)) ||
-            (ep_ptr->idle_count >= IDLE_TIMEOUT_DEFAULT)) {
-            /* The idle time has elapsed. */
-            idle_expiry = true;
+        /* Mark the players whose idle rate has passed. */
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            idle_check(ep_ptr, now);
         }
 
-        select_report(if_ix, &report, &prev_report);
+        /* Count host polls that found the endpoint unarmed. */
+        if (UEINTX & (1 << NAKINI)) {
+            UEINTX = (uint8_t)~(1 << NAKINI);
+            ep_ptr->naked_polls++;
+            if (ep_ptr->nothing_to_send) {
+                ep_ptr->empty_polls_avoided++;
+            }
+        }
+        ep_ptr->nothing_to_send = false;
 
-        /* Send reports if the endpoint is ready and there's been an
-         * idle-timeout, or a change in report contents.
+        /* Fill the free banks while reports are due; a full bank is still
+         * waiting for the host to collect its report.
          */
-        if (Endpoint_IsINReady() &&
-            (idle_expiry || (memcmp(prev_report, report, report_size) != 0))) {
+        while (Endpoint_IsINReady()) {
+            uint8_t slot = ep_ptr->next_slot;
+            uint8_t player_ix, turn;
+            Report_queue_t *queue;
+            uint8_t *report;
+            bool queued;
+
+            /* Find the next player, in turn, due a report: with one
+             * queued, or after an idle timeout.
+             */
+            for (turn = 0; turn < ep_ptr->players; turn++) {
+                queue = &Report_queue[ep_ptr->first_player + slot];
+                if ((queue->head != queue->tail) ||
+                    (ep_ptr->resend & (1 << slot))) {
+                    break;
+                }
+                if (++slot == ep_ptr->players) {
+                    slot = 0;
+                }
+            }
+
+            /* Otherwise leave the bank unarmed, so the host's polls are
+             * NAKed instead of collecting empty packets.
+             */
+            if (turn == ep_ptr->players) {
+                ep_ptr->nothing_to_send = true;
+                break;
+            }
+
+            /* The oldest queued report, or on an idle timeout with none
+             * queued, the last one sent again.
+             */
+            player_ix = ep_ptr->first_player + slot;
+            queued = (queue->head != queue->tail);
+            if (queued) {
+                report = queue->reports[queue->tail & (REPORT_QUEUE_LEN - 1)];
+            } else {
+                report = &prev_joystick_report_buffer[report_size * player_ix];
+            }
 
-            /* Write Joystick Report Data */
+            if (!aged && queued) {
+                record_report_age(published);
+                aged = true;
+            }
+
+            /* Write Joystick Report Data, after its report ID on a shared
+             * interface.
+             */
+            if (ep_ptr->players > 1) {
+                Endpoint_Write_8(IF_REPORT_ID(player_ix));
+            }
             Endpoint_Write_Stream_LE(report, report_size, NULL);
 
-            /* Save the current buffer data for comparing in next round. */
-            memcpy(prev_report, report, report_size);
+            /* Finalize the stream transfer to send the packet. */
+            Endpoint_ClearIN();
 
-            /* Reset the idle counter after a report is sent. */
-            ep_ptr->idle_count = 0;
-        }
+            ep_ptr->next_slot = (slot + 1 == ep_ptr->players) ? 0 : slot + 1;
+
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                if (queued) {
+                    queue->tail++;
+                } else {
+                    ep_ptr->idle_resends++;
+                }
+                ep_ptr->resend &= (uint8_t)~(1 << slot);
 
-        /* Finalize the stream transfer to send the last packet. */
-        Endpoint_ClearIN();
+                /* The player's idle rate runs from this report. */
+                ep_ptr->idle_last[slot] = now;
+                idle_schedule(ep_ptr, now);
+                ep_ptr->reports_sent++;
+            }
+        }
     }
 }
 
-/** Main program entry point.
- *
- * This routine contains the overall program flow,
- * including initial setup of all components and the main program loop.
- */
-int main(void)
+/** Initializes the application state and the hardware. */
+static void firmware_init(void)
 {
-    /* Initialize synchronization. */
-    sync_bytes = 0;
+    /* Initialize the serial link. */
+    link_decoder_init(&link_decoder);
+    link_rate = LINK_RATE_SAFE;
+    link_rate_request = LINK_RATE_NUM;
+    link_frame_errors = 0;
+    link_uart_errors_seen = 0;
+    link_resyncs = 0;
+
+    /* Load the settings; the Mega is sent them once it asks. */
+    settings_load();
+    settings_due = false;
+    settings_store_due = false;
+    memset(&link_rx_stats, 0, sizeof(link_rx_stats));
+    sleep_ticks = 0;
+    active_permille = 1000;
 
     /* Initialize the report buffers. */
-    memset(joystick_report_buffer, 0, JOYSTICK_REPORT_BUFFER_SIZE);
+    memset(joystick_report_buffers, 0, sizeof(joystick_report_buffers));
+    report_front = 0;
+    report_reader = 0;
+    report_due = false;
     memset(prev_joystick_report_buffer, 0, JOYSTICK_REPORT_BUFFER_SIZE);
-    RingBuffer_InitBuffer(&usart_to_usb_buffer, joystick_report_buffer,
-                          JOYSTICK_REPORT_BUFFER_SIZE);
+    memset(Report_queue, 0, sizeof(Report_queue));
 
     /* Reset endpoint states. */
     for (int if_ix = 0; if_ix < HID_IF_NUM; if_ix++) {
         Endpoint_state_t *ep_ptr = &Ep_state[if_ix];
 
         ep_ptr->ep_num = IF_EP_FIRST + if_ix;
-        ep_ptr->idle_timeout = IDLE_TIMEOUT_DEFAULT;
-        ep_ptr->idle_count = 0;
+        ep_ptr->first_player = IF_FIRST_PLAYER(if_ix);
+        ep_ptr->players = IF_PLAYERS(if_ix);
+        ep_ptr->next_slot = 0;
+        ep_ptr->resend = 0;
+        ep_ptr->nothing_to_send = false;
+        ep_ptr->reports_sent = 0;
+        ep_ptr->idle_resends = 0;
+        ep_ptr->reports_coalesced = 0;
+        ep_ptr->naked_polls = 0;
+        ep_ptr->empty_polls_avoided = 0;
     }
 
     /* Demo setup. */
     setup_hardware();
+}
+
+/** One pass of the main loop.
+ *
+ * With INTERRUPT_CONTROL_ENDPOINT, LUFA handles control requests in the
+ * USB interrupt, so USB_USBTask() has nothing left to do.
+ */
+static void firmware_task(void)
+{
+    link_rx_task();
+    link_task();
+#ifndef LOW_LATENCY_MODE
+    if (report_due) {
+        report_due = false;
+        interface_report();
+    }
+#endif
+#ifndef INTERRUPT_CONTROL_ENDPOINT
+    USB_USBTask();
+#endif
+}
+
+/** Sleep in idle mode until an interrupt leaves the main loop work.
+ *
+ * The USART receive interrupt, the start of frame event, control requests
+ * and the heartbeat's timer compare match all wake the CPU. The check is
+ * made with interrupts disabled, and sei only takes effect after the
+ * instruction that follows it, so an interrupt arriving after the check
+ * ends the sleep rather than being missed. The interrupt that ends a
+ * sleep is counted in its time.
+ */
+static void firmware_sleep(void)
+{
+    uint16_t start;
+
+    cli();
+    if ((link_rx_head != link_rx_tail) || report_due || settings_due ||
+        settings_store_due) {
+        sei();
+        return;
+    }
+
+    start = timer_now();
+    sleep_enable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+    sleep_ticks += timer_now() - start;
+}
+
+/** Main program entry point.
+ *
+ * This routine contains the overall program flow,
+ * including initial setup of all components and the main program loop.
+ * The host build (see host/) includes this file and drives firmware_init()
+ * and firmware_task() itself, in place of main().
+ */
+#ifndef HOST_BUILD
+int main(void)
+{
+    firmware_init();
 
     GlobalInterruptEnable();
 
     sei();
 
     for (;;) {
-        interface_report();
-        USB_USBTask();
+        firmware_task();
+        firmware_sleep();
     }
 }
+#endif /* HOST_BUILD */
 
 /** Event handler for the library USB Connection event. */
 void EVENT_USB_Device_Connect(void)
@@ -257,9 +1043,29 @@ void EVENT_USB_Device_Disconnect(void)
 /** Event handler for the library USB Configuration Changed event. */
 void EVENT_USB_Device_ConfigurationChanged(void)
 {
+    uint16_t now = usb_frame_now();
+
     for (int if_ix = 0; if_ix < HID_IF_NUM; if_ix++) {
-        Endpoint_ConfigureEndpoint(ENDPOINT_DIR_IN | Ep_state[if_ix].ep_num,
-                                   EP_TYPE_INTERRUPT, IF_EPSIZE, 1);
+        Endpoint_state_t *ep_ptr = &Ep_state[if_ix];
+
+        Endpoint_ConfigureEndpoint(ENDPOINT_DIR_IN | ep_ptr->ep_num,
+                                   EP_TYPE_INTERRUPT, IF_EPSIZE, 2);
+
+        /* Idle rates return to the default, counted from now, and reports
+         * queued for the old configuration are dropped.
+         */
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            for (uint8_t slot = 0; slot < ep_ptr->players; slot++) {
+                Report_queue_t *queue =
+                    &Report_queue[ep_ptr->first_player + slot];
+
+                ep_ptr->idle_rate[slot] = idle_default;
+                ep_ptr->idle_last[slot] = now;
+                queue->tail = queue->head;
+            }
+            ep_ptr->resend = 0;
+            idle_schedule(ep_ptr, now);
+        }
     }
 
     USB_Device_EnableSOFEvents();
@@ -273,9 +1079,114 @@ void EVENT_USB_Device_UnhandledControlRequest(void)
 /** Event handler for the USB device Start Of Frame event. */
 void EVENT_USB_Device_StartOfFrame(void)
 {
-    /* Advance all the endpoint idle counters. */
-    for (int if_ix = 0; if_ix < HID_IF_NUM; if_ix++) {
-        Ep_state[if_ix].idle_count++;
+    /* Advance the frame count the idle deadlines are kept against. */
+    usb_frame++;
+
+#ifndef LOW_LATENCY_MODE
+    report_due = true;
+#else
+    /* Submit the newest reports for the polls in this frame. The main loop
+     * may be part way through a control transfer, so the selected endpoint
+     * is restored afterwards.
+     */
+    uint8_t prev_endpoint = Endpoint_GetCurrentEndpoint();
+
+    interface_report();
+    Endpoint_SelectEndpoint(prev_endpoint);
+#endif
+}
+
+#if HID_IF_NUM > VENDOR_STATS_ENDPOINTS
+#error "Vendor_link_stats_t has too few endpoint counters"
+#endif
+
+/** Gather the link and report counters.
+ *
+ * Runs in the USB interrupt, which other interrupts may preempt, so the
+ * 16-bit counters are read with interrupts disabled, and the frame
+ * decoder's from the copy link_rx_task() keeps.
+ */
+static void link_stats_read(Vendor_link_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        stats->uart_frame_errors = link_uart_stats.frame_errors;
+        stats->uart_overruns = link_uart_stats.overruns;
+        stats->uart_parity_errors = link_uart_stats.parity_errors;
+        stats->rx_overflows = link_rx_overflows;
+
+        stats->frames = link_rx_stats.frames;
+        stats->crc_errors = link_rx_stats.crc_errors;
+        stats->framing_errors = link_rx_stats.framing_errors;
+        stats->lost_frames = link_rx_stats.lost_frames;
+        stats->resyncs = link_rx_stats.resyncs;
+        stats->active_permille = active_permille;
+
+        for (int if_ix = 0; if_ix < HID_IF_NUM; if_ix++) {
+            stats->reports_sent[if_ix] = Ep_state[if_ix].reports_sent;
+            stats->idle_resends[if_ix] = Ep_state[if_ix].idle_resends;
+            stats->reports_coalesced[if_ix] =
+                Ep_state[if_ix].reports_coalesced;
+        }
+    }
+
+    stats->link_rate = link_rate;
+    stats->endpoints = HID_IF_NUM;
+}
+
+/** Handle a vendor control request (see vendor_requests.h). */
+static void vendor_control_request(void)
+{
+    switch (USB_ControlRequest.bRequest) {
+    case VENDOR_REQ_GET_SETTINGS:
+        if ((USB_ControlRequest.bmRequestType == (REQDIR_DEVICETOHOST |
+                                                  REQTYPE_VENDOR |
+                                                  REQREC_DEVICE)) &&
+            (USB_ControlRequest.wLength == sizeof(link_settings_t))) {
+            Endpoint_ClearSETUP();
+            Endpoint_Write_Control_Stream_LE(&settings, sizeof(settings));
+            Endpoint_ClearOUT();
+        }
+        break;
+    case VENDOR_REQ_SET_SETTINGS:
+        if ((USB_ControlRequest.bmRequestType == (REQDIR_HOSTTODEVICE |
+                                                  REQTYPE_VENDOR |
+                                                  REQREC_DEVICE)) &&
+            (USB_ControlRequest.wLength == sizeof(link_settings_t))) {
+            link_settings_t new_settings;
+
+            Endpoint_ClearSETUP();
+            Endpoint_Read_Control_Stream_LE(&new_settings,
+                                            sizeof(new_settings));
+            if (!link_settings_valid(&new_settings)) {
+                Endpoint_StallTransaction();
+                break;
+            }
+            Endpoint_ClearIN();
+
+            /* The EEPROM is written by link_task(), rather than with the
+             * USB interrupt held up for milliseconds.
+             */
+            settings_apply(&new_settings);
+            settings_store_due = true;
+        }
+        break;
+    case VENDOR_REQ_GET_STATS:
+        if ((USB_ControlRequest.bmRequestType == (REQDIR_DEVICETOHOST |
+                                                  REQTYPE_VENDOR |
+                                                  REQREC_DEVICE)) &&
+            (USB_ControlRequest.wLength == sizeof(Vendor_link_stats_t))) {
+            Vendor_link_stats_t stats;
+
+            link_stats_read(&stats);
+            Endpoint_ClearSETUP();
+            Endpoint_Write_Control_Stream_LE(&stats, sizeof(stats));
+            Endpoint_ClearOUT();
+        }
+        break;
+    default:
+        break;
     }
 }
 
@@ -284,6 +1195,14 @@ void EVENT_USB_Device_ControlRequest(void)
 {
     uint8_t *report, *prev_report;
     uint8_t report_size;
+    uint8_t report_buffer[1 + sizeof(USB_joystick_report_data_t)];
+
+    /* Vendor requests reuse the HID class request codes. */
+    if ((USB_ControlRequest.bmRequestType & CONTROL_REQTYPE_TYPE) ==
+        REQTYPE_VENDOR) {
+        vendor_control_request();
+        return;
+    }
 
     /* Handle HID Class specific requests */
     switch (USB_ControlRequest.bRequest) {
@@ -291,14 +1210,34 @@ void EVENT_USB_Device_ControlRequest(void)
         if (USB_ControlRequest.bmRequestType == (REQDIR_DEVICETOHOST |
                                                  REQTYPE_CLASS |
                                                  REQREC_INTERFACE)) {
+            uint8_t if_ix = USB_ControlRequest.wIndex;
+            uint8_t report_id = (USB_ControlRequest.wValue & 0xFF);
+            uint8_t player_ix = 0;
+
             Endpoint_ClearSETUP();
 
-            /* Select the requested report. */
-            report_size = sizeof(USB_joystick_report_data_t);
-            select_report(USB_ControlRequest.wIndex, &report, &prev_report);
+            /* Select the requested report. On a shared interface the
+             * report ID picks the player, and prefixes the report.
+             */
+            report_size = 0;
+            if (if_ix < HID_IF_NUM) {
+                Endpoint_state_t *ep_ptr = &Ep_state[if_ix];
+
+                player_ix = ep_ptr->first_player;
+                if (ep_ptr->players > 1) {
+                    if ((report_id >= 1) && (report_id <= ep_ptr->players)) {
+                        player_ix += report_id - 1;
+                    }
+                    report_buffer[report_size++] = IF_REPORT_ID(player_ix);
+                }
+            }
+            select_report(claim_reports(), player_ix, &report, &prev_report);
+            memcpy(&report_buffer[report_size], report,
+                   sizeof(USB_joystick_report_data_t));
+            report_size += sizeof(USB_joystick_report_data_t);
 
             /* Write the report to the control endpoint */
-            Endpoint_Write_Control_Stream_LE(report, report_size);
+            Endpoint_Write_Control_Stream_LE(report_buffer, report_size);
             Endpoint_ClearOUT();
         }
         break;
@@ -314,10 +1253,10 @@ void EVENT_USB_Device_ControlRequest(void)
             if_ix = USB_ControlRequest.wIndex;
             if (if_ix < HID_IF_NUM) {
                 /* Get idle period in MSB, must multiply by 4 to get the
-                 * duration in milliseconds.
+                 * duration in milliseconds. The LSB is the report ID.
                  */
-                Ep_state[if_ix].idle_timeout =
-                    ((USB_ControlRequest.wValue & 0xFF00) >> 6);
+                idle_set(&Ep_state[if_ix], USB_ControlRequest.wValue & 0xFF,
+                         (USB_ControlRequest.wValue & 0xFF00) >> 6);
             }
         }
         break;
@@ -331,10 +1270,17 @@ void EVENT_USB_Device_ControlRequest(void)
 
             if_ix = USB_ControlRequest.wIndex;
             if (if_ix < HID_IF_NUM) {
+                Endpoint_state_t *ep_ptr = &Ep_state[if_ix];
+                uint8_t slot = USB_ControlRequest.wValue & 0xFF;
+
+                /* Report ID 0 reads the first report's rate. */
+                slot = ((slot >= 1) && (slot <= ep_ptr->players)) ?
+                       slot - 1 : 0;
+
                 /* Write the current idle duration to the host, must be
                  * divided by 4 before sent to host.
                  */
-                Endpoint_Write_8(Ep_state[if_ix].idle_timeout >> 2);
+                Endpoint_Write_8(ep_ptr->idle_rate[slot] >> 2);
             }
 
             Endpoint_ClearIN();
@@ -368,47 +1314,39 @@ void CALLBACK_HID_Device_ProcessHIDReport(USB_ClassInfo_HID_Device_t* const HIDI
     /* Not used but must be present */
 }
 
+/** Heartbeat timer compare match: only wakes the main loop. */
+EMPTY_INTERRUPT(TIMER1_COMPA_vect);
+
 /** Interrupt Service Register
  *
- * Manage the reception of data from the serial port, placing received bytes
- * into a circular buffer for later transmission to the host.
+ * Manage the reception of data from the serial port. The received byte is
+ * pushed onto the receive queue for link_rx_task() to decode, and UART
+ * errors are counted; nothing else is done with interrupts blocked.
  */
 ISR(USART1_RX_vect, ISR_BLOCK)
 {
+    uint8_t status = UCSR1A;
     uint8_t rx_byte = UDR1;
+    uint8_t head = link_rx_head;
+    uint8_t next = (head + 1) & (LINK_RX_QUEUE_SIZE - 1);
 
-    /*
-     * Check for the sync signal.
-     */
-    if (rx_byte == SYNC_BYTE) {
-        sync_bytes++;
-    } else {
-        if (sync_bytes) {
-            /* One or more previous bytes have been sync bytes (or looked like
-             * a sync byte). Handle the possible cases.
-             */
-            if (sync_bytes > 1) {
-                /* Received all sync bytes. Reset usart_to_usb_buffer.
-                 * We expect to receive 3 bytes, but 2 or more is sufficient.
-                 */
-                RingBuffer_InitBuffer(&usart_to_usb_buffer,
-                                      joystick_report_buffer,
-                                      JOYSTICK_REPORT_BUFFER_SIZE);
-            } else if (sync_bytes == 1) {
-                /* Broken sequence. The previous sync byte was actually a
-                 * data byte. This can happen if all buttons are depressed on
-                 * a joystick. Replay that byte and continue with the new one.
-                 */
-                RingBuffer_Insert(&usart_to_usb_buffer, SYNC_BYTE);
-            }
-
-            /* Reset for the next sync. */
-            sync_bytes = 0;
+    if (status & ((1 << FE1) | (1 << DOR1) | (1 << UPE1))) {
+        link_uart_errors++;
+        if (status & (1 << FE1)) {
+            link_uart_stats.frame_errors++;
         }
+        if (status & (1 << DOR1)) {
+            link_uart_stats.overruns++;
+        }
+        if (status & (1 << UPE1)) {
+            link_uart_stats.parity_errors++;
+        }
+    }
 
-        /*
-         * Store regular data.
-         */
-        RingBuffer_Insert(&usart_to_usb_buffer, rx_byte);
+    if (next != link_rx_tail) {
+        link_rx_queue[head] = rx_byte;
+        link_rx_head = next;
+    } else {
+        link_rx_overflows++;
     }
 }
@@ -63,10 +63,14 @@
 #include <avr/wdt.h>
 #include <avr/interrupt.h>
 #include <avr/power.h>
+#include <avr/eeprom.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
 
 #include "descriptors.h"
+#include "serial_link.h"
+#include "vendor_requests.h"
 
-#include <LUFA/Drivers/Misc/RingBuffer.h>
 #include <LUFA/Version.h>
 #include <LUFA/Drivers/Board/LEDs.h>
 #include <LUFA/Drivers/Peripheral/Serial.h>
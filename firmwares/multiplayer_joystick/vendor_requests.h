@@ -0,0 +1,78 @@
+/*
+ * vendor_requests.h
+ * Copyright (c) 2016 Matthew Nikkanen (mjnikkan [at] gmail [dot] com)
+ * Copyrights licensed under Unilicense.
+ * See the accompanying LICENSE file for terms.
+ */
+
+/** \file
+ *
+ * Vendor control requests, made to the device (not an interface) on the
+ * control endpoint. This header is plain C, without LUFA, so host tools
+ * can include it too.
+ */
+
+#ifndef _VENDOR_REQUESTS_H_
+#define _VENDOR_REQUESTS_H_
+
+#include <stdint.h>
+
+/** bmRequestType of vendor requests reading from, and writing to, the
+ * device.
+ */
+#define VENDOR_REQTYPE_IN       0xC0
+#define VENDOR_REQTYPE_OUT      0x40
+
+/** Vendor request codes (bRequest). */
+typedef enum Vendor_request_e_ {
+    /** Read the settings: IN, wLength sizeof(link_settings_t). */
+    VENDOR_REQ_GET_SETTINGS = 0x01,
+
+    /** Replace the settings and store them in EEPROM: OUT, wLength
+     * sizeof(link_settings_t). Settings that fail link_settings_valid()
+     * are refused with a stall.
+     */
+    VENDOR_REQ_SET_SETTINGS = 0x02,
+
+    /** Read the link and report counters: IN, wLength
+     * sizeof(Vendor_link_stats_t).
+     */
+    VENDOR_REQ_GET_STATS    = 0x03,
+} Vendor_request_e;
+
+/** Interfaces with their own endpoint counters; unused ones read 0. */
+#define VENDOR_STATS_ENDPOINTS  4
+
+/** Link and report counters, little endian, as read by
+ * VENDOR_REQ_GET_STATS.
+ *
+ * The counters run from power-up and wrap, so a host takes rates from the
+ * difference between two readings.
+ */
+typedef struct Vendor_link_stats_t_ {
+    /* USART receive errors, by status flag. */
+    uint16_t uart_frame_errors;         /* FE1: bad stop bit */
+    uint16_t uart_overruns;             /* DOR1: byte lost in the USART */
+    uint16_t uart_parity_errors;        /* UPE1 */
+    uint16_t rx_overflows;              /* Bytes lost to a full queue */
+
+    /* Frame decoder. */
+    uint16_t frames;                    /* Valid frames */
+    uint16_t crc_errors;
+    uint16_t framing_errors;            /* Broken COBS sequences */
+    uint16_t lost_frames;               /* Gaps in the sequence numbers */
+    uint16_t resyncs;                   /* Delimiters ending a bad frame */
+
+    uint8_t  link_rate;                 /* link_rate_e */
+    uint8_t  endpoints;                 /* Interfaces in use */
+
+    /* Per interface endpoint. */
+    uint16_t reports_sent[VENDOR_STATS_ENDPOINTS];
+    uint16_t idle_resends[VENDOR_STATS_ENDPOINTS]; /* Sent on idle timeout */
+    uint16_t reports_coalesced[VENDOR_STATS_ENDPOINTS]; /* Queue was full */
+
+    /* Main loop awake over the last heartbeat period, in thousandths. */
+    uint16_t active_permille;
+} Vendor_link_stats_t;
+
+#endif /* _VENDOR_REQUESTS_H_ */
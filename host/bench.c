@@ -0,0 +1,1466 @@
+/*
+ * Host benchmark for the sketch and the USB firmware.
+ *
+ * Drives simulated scans, UART bytes and start of frame events through the
+ * sketch's scan path, the firmware's receive interrupt and report task,
+ * and reports the cost of each per call. Host timings only track changes
+ * in the code's work; they are not AVR cycle counts.
+ *
+ * Finishes with an end-to-end run of the sketch wired to the firmware,
+ * which fails if the host ends up with reports that do not match the
+ * sketch's inputs, or if the link saw any errors, then checks autofire,
+ * short taps, link rate fallback, and the runtime settings on the sketch
+ * wired to the firmware.
+ *
+ * Usage: bench [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "harness.h"
+#include "serial_link.h"
+#include "vendor_requests.h"
+
+#define BENCH_ITERATIONS    1000000UL
+#define BENCH_BATCH         64
+#define BENCH_RX_CHUNK      32
+#define BENCH_STREAM_SIZE   (64 * 1024)
+#define BENCH_E2E_MS        60000UL
+#define BENCH_SETTLE_MS     50
+
+static uint32_t rng_state = 0x2545F491;
+
+static uint32_t rng(void)
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Cost of a now_ns() pair, subtracted from timings of single calls. */
+static uint64_t timer_overhead_ns;
+
+static void calibrate(void)
+{
+  uint64_t start = now_ns();
+  uint32_t ix;
+
+  for (ix = 0; ix < BENCH_ITERATIONS; ix++) {
+    (void)now_ns();
+  }
+  timer_overhead_ns = (now_ns() - start) / BENCH_ITERATIONS;
+}
+
+static void report(const char *name, unsigned long calls, uint64_t ns)
+{
+  double per_call = calls ? (double)ns / calls : 0.0;
+
+  printf("%-32s %10lu %10.1f %10.2f\n", name, calls, per_call,
+         per_call > 0 ? 1000.0 / per_call : 0.0);
+}
+
+static uint16_t random_inputs(void)
+{
+  /* Mostly idle, with a few switches and buttons active. */
+  uint32_t r = rng();
+
+  return (uint16_t)(r & (r >> 12) & 0x0FFF);
+}
+
+/*
+ * Sketch: full scan passes, and the state update on its own.
+ */
+static void bench_sketch(unsigned long iterations)
+{
+  unsigned long calls = 0;
+  uint64_t total = 0;
+
+  sk_set_tx_hook(NULL);
+  sk_setup();
+
+  while (calls < iterations) {
+    uint64_t start;
+    int ix;
+
+    sk_set_inputs(rng() % SK_PLAYER_NUM, random_inputs());
+
+    start = now_ns();
+    for (ix = 0; ix < BENCH_BATCH; ix++) {
+      sk_tick();
+    }
+    total += now_ns() - start;
+    calls += BENCH_BATCH;
+  }
+  report("sketch scan pass (loop)", calls, total);
+
+  calls = 0;
+  total = 0;
+  while (calls < iterations) {
+    uint64_t start = now_ns();
+    int ix;
+
+    for (ix = 0; ix < BENCH_BATCH; ix++) {
+      sk_update_joystick_states();
+    }
+    total += now_ns() - start;
+    calls += BENCH_BATCH * SK_PLAYER_NUM;
+  }
+  report("sketch update_joystick_state", calls, total);
+}
+
+/*
+ * Sketch: port snapshot decoding, against the per-pin digitalRead() loop it
+ * replaced, which reads through the Arduino core's own pin tables. Every
+ * port bit is pulled low alone, then every port is set at random; both
+ * ways of reading must agree on every player's inputs. Each pin of the
+ * players built in must be read by the loop as exactly one input.
+ */
+#define BENCH_PORT_RANDOM       10000
+
+static int check_port_decode(void)
+{
+  uint16_t decoded[SK_PLAYER_NUM], expected[SK_PLAYER_NUM];
+  uint8_t port, bit;
+  unsigned long round;
+  int player, pins = 0, failures = 0;
+
+  for (port = 0; port < SK_PORT_NUM; port++) {
+    sk_set_port(port, 0xFF);
+  }
+  for (port = 0; port < SK_PORT_NUM; port++) {
+    for (bit = 0; bit < 8; bit++) {
+      sk_set_port(port, (uint8_t)~(1 << bit));
+      if (!sk_read_ports(decoded)) {
+        printf("port decode: skipped, built with INPUT_SHIFT_REGISTERS\n");
+        return 0;
+      }
+      sk_digital_read(expected);
+      for (player = 0; player < SK_PLAYER_NUM; player++) {
+        if (expected[player]) {
+          pins++;
+        }
+        if ((decoded[player] != expected[player]) && (failures++ < 4)) {
+          printf("FAIL: port decode: port %u bit %u gave player %d %03x, "
+                 "digitalRead %03x\n", port, bit, player, decoded[player],
+                 expected[player]);
+        }
+      }
+      sk_set_port(port, 0xFF);
+    }
+  }
+  if (pins != SK_PLAYER_NUM * 12) {
+    printf("FAIL: port decode: %d pins read, expected %d\n", pins,
+           SK_PLAYER_NUM * 12);
+    failures++;
+  }
+
+  for (round = 0; round < BENCH_PORT_RANDOM; round++) {
+    for (port = 0; port < SK_PORT_NUM; port++) {
+      sk_set_port(port, (uint8_t)rng());
+    }
+    sk_read_ports(decoded);
+    sk_digital_read(expected);
+    if ((memcmp(decoded, expected, sizeof(decoded)) != 0) &&
+        (failures++ < 4)) {
+      printf("FAIL: port decode: random ports decoded differently from "
+             "digitalRead\n");
+    }
+  }
+  for (port = 0; port < SK_PORT_NUM; port++) {
+    sk_set_port(port, 0xFF);
+  }
+
+  printf("port decode: %d pins, %d players, %d random ports, %d failures\n",
+         pins, SK_PLAYER_NUM, BENCH_PORT_RANDOM, failures);
+  return failures != 0;
+}
+
+#if ANALOG_AXES
+/*
+ * Sketch: analog axes. The sticks rest at centre for the first ADC sweep,
+ * which calibrates them, then each stick is thrown to both ends of its
+ * travel and back to just inside the deadzone. The reported axes must
+ * reach the ends of the range, and read as centred inside the deadzone.
+ */
+static int check_analog_axes(void)
+{
+  static const struct {
+    uint16_t x, y;      /* 10-bit ADC readings */
+    uint8_t  ax, ay;    /* Expected axes */
+  } steps[] = {
+    {    0, 1023,   0, 255 },
+    { 1023,    0, 255,   0 },
+    {  520,  504, 128, 128 },
+  };
+  uint8_t state[SK_STATE_SIZE];
+  int player, step, tick, failures = 0;
+
+  sk_set_tx_hook(NULL);
+  sk_setup();
+  for (tick = 0; tick < 10; tick++) {
+    sk_tick();
+  }
+
+  for (step = 0; step < (int)(sizeof(steps) / sizeof(steps[0])); step++) {
+    for (player = 0; player < SK_PLAYER_NUM; player++) {
+      sk_set_analog(player, steps[step].x, steps[step].y);
+    }
+    for (tick = 0; tick < 10; tick++) {
+      sk_tick();
+    }
+    for (player = 0; player < SK_PLAYER_NUM; player++) {
+      sk_state(player, state);
+      if ((state[0] != steps[step].ax) || (state[1] != steps[step].ay)) {
+        printf("FAIL: analog step %d, player %d: axes %u %u, "
+               "expected %u %u\n", step, player, state[0], state[1],
+               steps[step].ax, steps[step].ay);
+        failures++;
+      }
+    }
+  }
+  printf("analog: %d sticks thrown to %d positions, %d failures\n",
+         SK_PLAYER_NUM, (int)(sizeof(steps) / sizeof(steps[0])), failures);
+  return failures != 0;
+}
+#endif
+
+/*
+ * Sketch: shift-layer remapping. Every possible input word is remapped by
+ * table and checked against the layer definitions applied one input at a
+ * time, then the table lookup is timed.
+ */
+static int check_input_remap(unsigned long iterations)
+{
+  uint16_t words[BENCH_BATCH];
+  volatile uint16_t sink;
+  unsigned long calls = 0;
+  uint64_t total = 0;
+  uint16_t word;
+  int ix, failures = 0;
+
+  for (word = 0; word < (1 << 12); word++) {
+    uint16_t by_table = word, by_bit = word;
+
+    if (!sk_remap(&by_table, false)) {
+      printf("remap: skipped, built without INPUT_REMAP\n");
+      return 0;
+    }
+    sk_remap(&by_bit, true);
+    if ((by_table != by_bit) && (failures++ < 4)) {
+      printf("FAIL: remap %03x: %03x, expected %03x\n", word, by_table,
+             by_bit);
+    }
+  }
+
+  for (ix = 0; ix < BENCH_BATCH; ix++) {
+    words[ix] = random_inputs();
+  }
+  while (calls < iterations) {
+    uint64_t start = now_ns();
+
+    for (ix = 0; ix < BENCH_BATCH; ix++) {
+      word = words[ix];
+      sk_remap(&word, false);
+      sink = word;
+    }
+    total += now_ns() - start;
+    calls += BENCH_BATCH;
+  }
+  (void)sink;
+  report("sketch remap_inputs", calls, total);
+  printf("remap: 4096 input words, %d failures\n", failures);
+  return failures != 0;
+}
+
+/*
+ * Link framing: the COBS and CRC-8 frame codec (see serial_link.h), fed
+ * through a decoder of its own. Random frames must decode exactly as
+ * encoded. Every frame with one payload or CRC bit flipped must be
+ * dropped as a CRC error. Frames that are truncated, have a zero injected,
+ * have any bit flipped, or are replaced by an overlong run of bytes or by
+ * noise must never take the decoder past its buffer, and the decoder must
+ * pick up the good frame after the next delimiter. Overlong runs must be
+ * dropped as framing errors. Corrupted frames other than the single bit
+ * flips may still pass the CRC by chance, about one in 256 of those
+ * decoded, so those are only counted.
+ */
+#define BENCH_FUZZ_FRAMES       100000UL
+
+typedef enum fuzz_e_ {
+  FUZZ_NONE = 0,
+  FUZZ_TRUNCATE,
+  FUZZ_ZERO,
+  FUZZ_FLIP,
+  FUZZ_OVERLONG,
+  FUZZ_NOISE,
+  FUZZ_NUM,
+} fuzz_e;
+
+/*
+ * Push bytes to a decoder, checking it stays within its buffer. Returns
+ * the number of frames delivered, the last of them copied to frame, or
+ * -1 if the decoder overran.
+ */
+static int fuzz_push(link_decoder_t *dec, const uint8_t *bytes, int len,
+                     uint8_t frame[LINK_FRAME_MAX], uint8_t *frame_len)
+{
+  int ix, frames = 0;
+
+  for (ix = 0; ix < len; ix++) {
+    uint8_t got = link_decoder_push(dec, bytes[ix]);
+
+    if ((dec->len > LINK_FRAME_MAX) || (got > LINK_FRAME_MAX)) {
+      return -1;
+    }
+    if (got) {
+      memcpy(frame, dec->frame, got);
+      *frame_len = got;
+      frames++;
+    }
+  }
+  return frames;
+}
+
+/* Build and encode a random frame, keeping its decoded form. */
+static uint8_t fuzz_frame(uint8_t decoded[LINK_FRAME_MAX],
+                          uint8_t *decoded_len, uint8_t *encoded)
+{
+  uint8_t len = rng() % (LINK_PAYLOAD_MAX + 1);
+  uint8_t ix;
+
+  /* A frame type the link uses, then plenty of zeros for the COBS blocks. */
+  decoded[0] = LINK_FRAME_STATE + rng() % LINK_FRAME_SETTINGS;
+  for (ix = 1; ix < len + LINK_HEADER_SIZE; ix++) {
+    decoded[ix] = (rng() & 3) ? (uint8_t)rng() : 0;
+  }
+  decoded[ix] = link_crc8(decoded, ix);
+  *decoded_len = ix + LINK_CRC_SIZE;
+  return link_frame_encode(decoded[0], decoded[1], &decoded[LINK_HEADER_SIZE],
+                           len, encoded);
+}
+
+/* Whether an encoded byte is a COBS code byte rather than frame data. */
+static bool fuzz_is_code(const uint8_t *encoded, uint8_t pos)
+{
+  uint8_t code_ix = 0;
+
+  while (code_ix < pos) {
+    code_ix += encoded[code_ix];
+  }
+  return code_ix == pos;
+}
+
+static int check_link_framing(void)
+{
+  static const char *const names[FUZZ_NUM] = {
+    "clean", "truncated", "zero", "flipped", "overlong", "noise",
+  };
+  link_decoder_t dec;
+  uint8_t sent[LINK_FRAME_MAX], got[LINK_FRAME_MAX];
+  uint8_t sent_len, got_len = 0;
+  uint8_t encoded[LINK_ENCODED_MAX], stream[4 * LINK_ENCODED_MAX];
+  unsigned long count[FUZZ_NUM], chance[FUZZ_NUM];
+  unsigned long frame;
+  uint16_t crc_errors, framing_errors;
+  int failures = 0;
+
+  memset(count, 0, sizeof(count));
+  memset(chance, 0, sizeof(chance));
+  link_decoder_init(&dec);
+
+  for (frame = 0; frame < BENCH_FUZZ_FRAMES; frame++) {
+    fuzz_e fuzz = (fuzz_e)(frame % FUZZ_NUM);
+    uint8_t enc_len = fuzz_frame(sent, &sent_len, encoded);
+    uint8_t data_len = enc_len - 1;   /* Without the delimiter */
+    uint8_t pos = 1 + rng() % (data_len - 1);
+    bool crc_flip = false;
+    int len = 0, frames;
+
+    crc_errors = dec.crc_errors;
+    framing_errors = dec.framing_errors;
+
+    switch (fuzz) {
+    case FUZZ_NONE:
+      memcpy(stream, encoded, enc_len);
+      len = enc_len;
+      break;
+    case FUZZ_TRUNCATE:
+      /* Cut short, and the next delimiter arrives. */
+      memcpy(stream, encoded, pos);
+      len = pos;
+      stream[len++] = LINK_DELIMITER;
+      break;
+    case FUZZ_ZERO:
+      memcpy(stream, encoded, pos);
+      stream[pos] = LINK_DELIMITER;
+      memcpy(&stream[pos + 1], &encoded[pos], enc_len - pos);
+      len = enc_len + 1;
+      break;
+    case FUZZ_FLIP:
+      memcpy(stream, encoded, enc_len);
+      pos = rng() % data_len;
+      stream[pos] ^= 1 << (rng() & 7);
+      len = enc_len;
+      /* A data bit that leaves no zero behind is the CRC's to catch. */
+      crc_flip = !fuzz_is_code(encoded, pos) &&
+                 (stream[pos] != LINK_DELIMITER);
+      break;
+    case FUZZ_OVERLONG:
+      /* Too many bytes for any frame, whatever the code bytes say. */
+      len = 2 * LINK_ENCODED_MAX + rng() % LINK_ENCODED_MAX;
+      for (pos = 0; pos < len; pos++) {
+        stream[pos] = (uint8_t)(1 + rng() % 0xFF);
+      }
+      stream[len++] = LINK_DELIMITER;
+      break;
+    case FUZZ_NOISE:
+    default:
+      len = 1 + rng() % (2 * LINK_ENCODED_MAX);
+      for (pos = 0; pos < len; pos++) {
+        stream[pos] = (rng() & 7) ? (uint8_t)rng() : LINK_DELIMITER;
+      }
+      stream[len++] = LINK_DELIMITER;
+      break;
+    }
+    count[fuzz]++;
+
+    frames = fuzz_push(&dec, stream, len, got, &got_len);
+    if (frames < 0) {
+      printf("FAIL: framing: %s frame %lu overran the decoder\n",
+             names[fuzz], frame);
+      return 1;
+    }
+
+    if (fuzz == FUZZ_NONE) {
+      if ((frames != 1) || (got_len != sent_len) ||
+          (memcmp(got, sent, sent_len) != 0)) {
+        if (failures++ < 4) {
+          printf("FAIL: framing: frame %lu of %u bytes not decoded as "
+                 "sent\n", frame, sent_len);
+        }
+      }
+      continue;
+    }
+
+    if (crc_flip && ((frames != 0) || (dec.crc_errors == crc_errors) ||
+                     (dec.framing_errors != framing_errors))) {
+      if (failures++ < 4) {
+        printf("FAIL: framing: frame %lu with byte %u flipped not "
+               "rejected by its CRC\n", frame, pos);
+      }
+    } else if ((fuzz == FUZZ_OVERLONG) &&
+               ((frames != 0) || (dec.framing_errors == framing_errors))) {
+      if (failures++ < 4) {
+        printf("FAIL: framing: overlong run %lu not rejected\n", frame);
+      }
+    } else if (frames != 0) {
+      chance[fuzz]++;
+    }
+
+    /* The next frame after a delimiter must come through. */
+    enc_len = fuzz_frame(sent, &sent_len, encoded);
+    frames = fuzz_push(&dec, encoded, enc_len, got, &got_len);
+    if ((frames != 1) || (got_len != sent_len) ||
+        (memcmp(got, sent, sent_len) != 0)) {
+      if (failures++ < 4) {
+        printf("FAIL: framing: no resync after %s frame %lu\n",
+               names[fuzz], frame);
+      }
+    }
+  }
+
+  printf("framing: %lu frames, %lu corrupted passed the CRC by chance "
+         "(%lu truncated, %lu zero, %lu flipped, %lu noise), %d failures\n",
+         BENCH_FUZZ_FRAMES,
+         chance[FUZZ_TRUNCATE] + chance[FUZZ_ZERO] + chance[FUZZ_FLIP] +
+         chance[FUZZ_NOISE], chance[FUZZ_TRUNCATE], chance[FUZZ_ZERO],
+         chance[FUZZ_FLIP], chance[FUZZ_NOISE], failures);
+  return failures != 0;
+}
+
+/*
+ * Firmware: receive interrupt and frame decoding, per byte.
+ */
+static void bench_uart(unsigned long iterations)
+{
+  static uint8_t stream[BENCH_STREAM_SIZE];
+  uint8_t states[LINK_STATE_PAYLOAD_SIZE(SK_PLAYER_NUM)];
+  uint32_t stream_len = 0;
+  uint8_t seq = 0;
+  unsigned long calls = 0;
+  uint64_t isr_total = 0, decode_total = 0;
+  uint32_t pos = 0;
+
+  while (stream_len + LINK_ENCODED_MAX <= sizeof(stream)) {
+    int ix;
+
+    for (ix = 0; ix < (int)sizeof(states); ix++) {
+      states[ix] = (uint8_t)rng();
+    }
+    stream_len += link_frame_encode(LINK_FRAME_STATE, seq++, states,
+                                    sizeof(states), &stream[stream_len]);
+  }
+
+  fw_set_tx_hook(NULL);
+  fw_init();
+
+  while (calls < iterations) {
+    uint64_t start;
+    int ix;
+
+    start = now_ns();
+    for (ix = 0; ix < BENCH_RX_CHUNK; ix++) {
+      fw_uart_rx(stream[pos]);
+      pos = (pos + 1) % stream_len;
+    }
+    isr_total += now_ns() - start;
+
+    start = now_ns();
+    fw_link_rx_task();
+    decode_total += now_ns() - start;
+
+    calls += BENCH_RX_CHUNK;
+  }
+  report("firmware USART1_RX_vect", calls, isr_total);
+  report("firmware link_rx_task per byte", calls, decode_total);
+}
+
+/*
+ * Firmware: report task, with new reports every pass and with none, and
+ * the start of frame event.
+ */
+static void bench_reports(unsigned long iterations)
+{
+  uint8_t states[SK_PLAYER_NUM * SK_STATE_SIZE];
+  unsigned long calls;
+  uint64_t total, start, elapsed;
+
+  fw_set_tx_hook(NULL);
+  fw_init();
+
+  for (calls = 0, total = 0; calls < iterations; calls++) {
+    states[rng() % sizeof(states)] = (uint8_t)rng();
+    fw_publish_state(states, sizeof(states));
+
+    start = now_ns();
+    fw_interface_report();
+    elapsed = now_ns() - start;
+    total += (elapsed > timer_overhead_ns) ? elapsed - timer_overhead_ns : 0;
+
+    fw_host_poll(NULL);
+  }
+  report("firmware interface_report, new", calls, total);
+
+  for (calls = 0, total = 0; calls < iterations; calls++) {
+    start = now_ns();
+    fw_interface_report();
+    elapsed = now_ns() - start;
+    total += (elapsed > timer_overhead_ns) ? elapsed - timer_overhead_ns : 0;
+
+    fw_host_poll(NULL);
+  }
+  report("firmware interface_report, same", calls, total);
+
+  for (calls = 0, total = 0; calls < iterations; calls++) {
+    if ((calls & 7) == 0) {
+      states[rng() % sizeof(states)] = (uint8_t)rng();
+      fw_publish_state(states, sizeof(states));
+    }
+
+    start = now_ns();
+    fw_sof();
+    elapsed = now_ns() - start;
+    total += (elapsed > timer_overhead_ns) ? elapsed - timer_overhead_ns : 0;
+
+    fw_host_poll(NULL);
+  }
+  report("firmware start of frame event", calls, total);
+}
+
+/*
+ * End to end: the sketch wired to the firmware, one scan and one frame per
+ * simulated millisecond.
+ */
+static void sketch_to_firmware(uint8_t byte)
+{
+  fw_uart_rx(byte);
+}
+
+static void firmware_to_sketch(uint8_t byte)
+{
+  sk_serial_rx(byte);
+}
+
+/*
+ * Start the sketch wired to the firmware. Without replies, the firmware's
+ * output is dropped, so the sketch hears nothing back.
+ */
+static void linked_init(bool replies)
+{
+  fw_set_tx_hook(replies ? firmware_to_sketch : NULL);
+  sk_set_tx_hook(sketch_to_firmware);
+  fw_init();
+  sk_setup();
+}
+
+/*
+ * One simulated millisecond of the firmware alone: a frame starts, the
+ * report task runs, and the host polls. Reports collected are stored in
+ * seen, unless it is NULL; returns the players collected, as
+ * fw_host_poll() does.
+ */
+static uint8_t run_frame(uint8_t seen[][SK_STATE_SIZE])
+{
+  fw_advance_us(1000);
+  fw_sof();
+  fw_interface_report();
+  return fw_host_poll(seen);
+}
+
+/*
+ * One simulated millisecond of the sketch wired to the firmware: a scan, a
+ * pass of the firmware's main loop, then a frame and the host's poll, as
+ * run_frame().
+ */
+static uint8_t run_linked_ms(uint8_t seen[][SK_STATE_SIZE])
+{
+  sk_tick();
+  fw_task();
+  fw_advance_us(1000);
+  fw_sof();
+  return fw_host_poll(seen);
+}
+
+/* Run the sketch wired to the firmware for a number of milliseconds. */
+static void run_linked(unsigned long ms)
+{
+  unsigned long tick;
+
+  for (tick = 0; tick < ms; tick++) {
+    run_linked_ms(NULL);
+  }
+}
+
+static int bench_end_to_end(unsigned long ms)
+{
+  uint8_t host[SK_PLAYER_NUM][SK_STATE_SIZE];
+  uint8_t seen[SK_PLAYER_NUM][SK_STATE_SIZE];
+  uint8_t collected;
+  unsigned long reports = 0;
+  unsigned long tick;
+  uint64_t start, elapsed;
+  fw_stats_t stats;
+  int player, mismatches = 0;
+
+  memset(host, 0, sizeof(host));
+  linked_init(true);
+
+  start = now_ns();
+  for (tick = 0; tick < ms + BENCH_SETTLE_MS; tick++) {
+    /* Inputs change every few milliseconds, then settle at the end. */
+    if ((tick < ms) && ((rng() & 3) == 0)) {
+      sk_set_inputs(rng() % SK_PLAYER_NUM, random_inputs());
+    }
+#if ANALOG_AXES
+    if ((tick < ms) && ((rng() & 7) == 0)) {
+      sk_set_analog(rng() % SK_PLAYER_NUM, rng() & 0x3FF, rng() & 0x3FF);
+    }
+#endif
+
+    collected = run_linked_ms(seen);
+    for (player = 0; player < SK_PLAYER_NUM; player++) {
+      if (collected & (1 << player)) {
+        memcpy(host[player], seen[player], SK_STATE_SIZE);
+        reports++;
+      }
+    }
+  }
+  elapsed = now_ns() - start;
+  report("end to end, per simulated ms", tick, elapsed);
+
+  for (player = 0; player < SK_PLAYER_NUM; player++) {
+    uint8_t state[SK_STATE_SIZE];
+
+    sk_state(player, state);
+    if (memcmp(state, host[player], SK_STATE_SIZE) != 0) {
+      mismatches++;
+    }
+  }
+
+  fw_stats(&stats);
+  printf("\nlink: rate %u/%u, %u frames, %u crc errors, %u framing errors, "
+         "%u lost, %u overflows\n",
+         sk_link_rate(), stats.link_rate, stats.frames, stats.crc_errors,
+         stats.framing_errors, stats.lost_frames, stats.rx_overflows);
+  printf("usb: %lu reports collected, report age max %u us\n",
+         reports, stats.report_age_max * 4);
+
+  if (mismatches || stats.crc_errors || stats.framing_errors ||
+      stats.rx_overflows) {
+    printf("FAIL: %d players' reports do not match the sketch\n", mismatches);
+    return 1;
+  }
+  return 0;
+}
+
+/*
+ * Firmware: link and report counters, read back with the vendor request.
+ * Valid frames, bytes with each USART error flag, a receive queue overrun
+ * and a corrupted frame are fed to the receive interrupt, then the reports
+ * are left unchanged long enough for every endpoint to be resent on idle.
+ */
+#define BENCH_STATS_FRAMES      3
+#define BENCH_STATS_BURST       256
+#define BENCH_STATS_IDLE_MS     2500
+
+static int check_link_stats(void)
+{
+  static const uint8_t none[SK_PLAYER_NUM * SK_STATE_SIZE];
+  uint8_t frame[LINK_ENCODED_MAX];
+  Vendor_link_stats_t stats;
+  uint8_t len, ix;
+  int tick, failures = 0;
+
+  fw_set_tx_hook(NULL);
+  fw_init();
+
+  for (ix = 0; ix < BENCH_STATS_FRAMES; ix++) {
+    len = link_frame_encode(LINK_FRAME_SETTINGS_REQUEST, ix, NULL, 0, frame);
+    for (tick = 0; tick < len; tick++) {
+      fw_uart_rx(frame[tick]);
+    }
+    fw_link_rx_task();
+  }
+
+  /* A corrupted frame, then more bytes than the queue holds. */
+  fw_uart_rx(0x55);
+  fw_uart_rx_error(0x55, FW_UART_FRAME_ERROR);
+  fw_uart_rx_error(0x55, FW_UART_OVERRUN);
+  fw_uart_rx_error(0x55, FW_UART_FRAME_ERROR | FW_UART_PARITY_ERROR);
+  fw_uart_rx(LINK_DELIMITER);
+  fw_link_rx_task();
+  for (tick = 0; tick < BENCH_STATS_BURST; tick++) {
+    fw_uart_rx(0x55);
+  }
+  fw_link_rx_task();
+  fw_uart_rx(LINK_DELIMITER);
+  fw_link_rx_task();
+
+  fw_publish_state(none, sizeof(none));
+  for (tick = 0; tick < BENCH_STATS_IDLE_MS; tick++) {
+    run_frame(NULL);
+  }
+
+  if (fw_control_request(VENDOR_REQTYPE_IN, VENDOR_REQ_GET_STATS, 0, 0,
+                         &stats, sizeof(stats)) != sizeof(stats)) {
+    printf("FAIL: link stats: request failed\n");
+    return 1;
+  }
+
+  if ((stats.uart_frame_errors != 2) || (stats.uart_overruns != 1) ||
+      (stats.uart_parity_errors != 1)) {
+    printf("FAIL: link stats: %u frame errors, %u overruns, %u parity "
+           "errors\n", stats.uart_frame_errors, stats.uart_overruns,
+           stats.uart_parity_errors);
+    failures++;
+  }
+  if ((stats.rx_overflows == 0) || (stats.rx_overflows >= BENCH_STATS_BURST)) {
+    printf("FAIL: link stats: %u of %u bytes overflowed\n",
+           stats.rx_overflows, BENCH_STATS_BURST);
+    failures++;
+  }
+  /* The state frame was published directly, not received. */
+  if ((stats.frames != BENCH_STATS_FRAMES) || (stats.resyncs != 2) ||
+      (stats.framing_errors + stats.crc_errors != 2) ||
+      (stats.endpoints == 0) || (stats.endpoints > VENDOR_STATS_ENDPOINTS) ||
+      (stats.active_permille > 1000)) {
+    printf("FAIL: link stats: %u frames, %u resyncs, %u framing errors, "
+           "%u crc errors, %u endpoints, %u/1000 active\n", stats.frames,
+           stats.resyncs, stats.framing_errors, stats.crc_errors,
+           stats.endpoints, stats.active_permille);
+    failures++;
+  }
+  for (ix = 0; ix < stats.endpoints; ix++) {
+    if ((stats.idle_resends[ix] < BENCH_STATS_IDLE_MS / 1000) ||
+        (stats.reports_sent[ix] < stats.idle_resends[ix])) {
+      printf("FAIL: link stats: endpoint %u sent %u reports, %u on idle\n",
+             ix, stats.reports_sent[ix], stats.idle_resends[ix]);
+      failures++;
+    }
+  }
+
+  printf("link stats: %u endpoints, %u reports, %u idle resends on the "
+         "first, %d failures\n", stats.endpoints, stats.reports_sent[0],
+         stats.idle_resends[0], failures);
+  return failures != 0;
+}
+
+/*
+ * Firmware: idle rates. With idle 0 set for every report, unchanged
+ * reports must never be resent. Then every report is set to 100 ms and,
+ * on shared interfaces, the second report ID to 200 ms; each player's
+ * unchanged report must come back at its own rate. The host collects one
+ * report a frame from a shared interface, so a player's report may wait a
+ * frame in the second bank behind the other's, and arrive a frame late or,
+ * the next time, a frame early.
+ */
+#define BENCH_HID_REQTYPE_OUT   0x21    /* Class, interface */
+#define BENCH_HID_REQTYPE_IN    0xA1
+#define BENCH_HID_GET_IDLE      0x02
+#define BENCH_HID_SET_IDLE      0x0A
+#define BENCH_IDLE_QUIET_MS     3000
+#define BENCH_IDLE_RUN_MS       2000
+#define BENCH_IDLE_RATE         25      /* 4 ms units: 100 ms */
+
+/* Run the firmware's report task for a number of frames, recording when
+ * each player's report is collected.
+ */
+static unsigned long run_idle(unsigned long frames,
+                              uint32_t last[SK_PLAYER_NUM],
+                              uint32_t *frame, int *failures,
+                              const uint16_t expected[SK_PLAYER_NUM])
+{
+  unsigned long collected = 0;
+  unsigned long tick;
+  uint8_t players;
+  int player;
+
+  for (tick = 0; tick < frames; tick++) {
+    players = run_frame(NULL);
+    (*frame)++;
+    for (player = 0; player < SK_PLAYER_NUM; player++) {
+      uint32_t interval = *frame - last[player];
+
+      if (!(players & (1 << player))) {
+        continue;
+      }
+      /* The first report after the rate is set comes at once. */
+      if (expected && last[player] &&
+          ((interval + 1 < expected[player]) ||
+           (interval > (uint32_t)expected[player] + 1))) {
+        if ((*failures)++ < 4) {
+          printf("FAIL: idle: player %d resent after %u ms, expected "
+                 "%u\n", player, interval, expected[player]);
+        }
+      }
+      last[player] = *frame;
+      collected++;
+    }
+  }
+  return collected;
+}
+
+static int check_idle_rates(void)
+{
+  static const uint8_t states[SK_PLAYER_NUM * SK_STATE_SIZE];
+  uint16_t expected[SK_PLAYER_NUM] = {0};
+  uint32_t last[SK_PLAYER_NUM];
+  uint32_t frame = 0;
+  unsigned long resent;
+  uint8_t if_ix, players, id, rate;
+  int player = 0, failures = 0;
+
+  fw_set_tx_hook(NULL);
+  fw_init();
+
+  fw_publish_state(states, sizeof(states));
+
+  for (if_ix = 0; fw_interface_players(if_ix); if_ix++) {
+    fw_control_request(BENCH_HID_REQTYPE_OUT, BENCH_HID_SET_IDLE, 0, if_ix,
+                       NULL, 0);
+  }
+  memset(last, 0, sizeof(last));
+  resent = run_idle(BENCH_IDLE_QUIET_MS, last, &frame, &failures, NULL);
+  if (resent) {
+    printf("FAIL: idle: %lu reports resent with idle 0\n", resent);
+    failures++;
+  }
+
+  for (if_ix = 0; (players = fw_interface_players(if_ix)); if_ix++) {
+    fw_control_request(BENCH_HID_REQTYPE_OUT, BENCH_HID_SET_IDLE,
+                       BENCH_IDLE_RATE << 8, if_ix, NULL, 0);
+    if (players > 1) {
+      fw_control_request(BENCH_HID_REQTYPE_OUT, BENCH_HID_SET_IDLE,
+                         (BENCH_IDLE_RATE * 2) << 8 | 2, if_ix, NULL, 0);
+    }
+    for (id = 1; id <= players; id++, player++) {
+      expected[player] = (id == 1) ? BENCH_IDLE_RATE * 4 :
+                                     BENCH_IDLE_RATE * 8;
+      rate = 0;
+      if ((fw_control_request(BENCH_HID_REQTYPE_IN, BENCH_HID_GET_IDLE,
+                              (players > 1) ? id : 0, if_ix,
+                              &rate, 1) != 1) ||
+          (rate * 4 != expected[player])) {
+        printf("FAIL: idle: interface %u report %u reads idle %u\n",
+               if_ix, id, rate);
+        failures++;
+      }
+    }
+  }
+  memset(last, 0, sizeof(last));
+  resent = run_idle(BENCH_IDLE_RUN_MS, last, &frame, &failures, expected);
+
+  printf("idle: %lu reports resent in %u ms, %d failures\n", resent,
+         BENCH_IDLE_RUN_MS, failures);
+  return failures != 0;
+}
+
+/* Buttons of a player state, as reported. */
+static uint8_t state_buttons(const uint8_t state[SK_STATE_SIZE])
+{
+#if COMPACT_REPORT
+  return (uint8_t)((state[0] >> 4) | (state[1] << 4));
+#else
+  return state[2];
+#endif
+}
+
+/*
+ * Sketch and firmware: autofire. Every player holds button 1, pressed
+ * between report period boundaries, for BENCH_AUTOFIRE_MS. Each phase must
+ * last exactly the configured time, except the first, which keeps the part
+ * of a period before the first boundary as well. The host must see every
+ * toggle the sketch makes.
+ */
+#define BENCH_AUTOFIRE_MS       1000
+#define BENCH_AUTOFIRE_BUTTON   0x01    /* Button 1 */
+
+static int check_autofire(void)
+{
+  uint8_t sketch[SK_PLAYER_NUM], host[SK_PLAYER_NUM];
+  uint16_t phase[SK_PLAYER_NUM], sketch_toggles[SK_PLAYER_NUM];
+  uint16_t host_toggles[SK_PLAYER_NUM];
+  uint8_t seen[SK_PLAYER_NUM][SK_STATE_SIZE];
+  uint8_t collected;
+  uint16_t phase_ticks = sk_autofire_ticks(0, 0);
+  int player, tick, failures = 0;
+
+  if (phase_ticks == 0) {
+    printf("autofire: skipped, built without AUTOFIRE\n");
+    return 0;
+  }
+
+  memset(sketch, 0, sizeof(sketch));
+  memset(host, 0, sizeof(host));
+  memset(phase, 0, sizeof(phase));
+  memset(sketch_toggles, 0, sizeof(sketch_toggles));
+  memset(host_toggles, 0, sizeof(host_toggles));
+  linked_init(true);
+
+  for (tick = 0; tick < BENCH_SETTLE_MS + BENCH_AUTOFIRE_MS; tick++) {
+    /* On an odd scan since setup, so not on a boundary. */
+    if (tick == BENCH_SETTLE_MS) {
+      for (player = 0; player < SK_PLAYER_NUM; player++) {
+        sk_set_inputs(player, 1 << 4);
+      }
+    }
+
+    collected = run_linked_ms(seen);
+    for (player = 0; player < SK_PLAYER_NUM; player++) {
+      uint8_t state[SK_STATE_SIZE];
+      uint8_t pressed;
+
+      sk_state(player, state);
+      pressed = state_buttons(state) & BENCH_AUTOFIRE_BUTTON;
+      phase[player]++;
+      if (pressed != sketch[player]) {
+        /* The first press and the phase cut off at the end are free. */
+        if ((sketch_toggles[player] == 1) ?
+            ((phase[player] < phase_ticks) ||
+             (phase[player] >= 2 * phase_ticks)) :
+            ((sketch_toggles[player] > 1) && (phase[player] != phase_ticks))) {
+          if (failures++ < 4) {
+            printf("FAIL: autofire player %d, phase %u: %u ticks, "
+                   "expected %u\n", player, sketch_toggles[player],
+                   phase[player], phase_ticks);
+          }
+        }
+        sketch[player] = pressed;
+        sketch_toggles[player]++;
+        phase[player] = 0;
+      }
+
+      pressed = state_buttons(seen[player]) & BENCH_AUTOFIRE_BUTTON;
+      if ((collected & (1 << player)) && (pressed != host[player])) {
+        host[player] = pressed;
+        host_toggles[player]++;
+      }
+    }
+  }
+
+  for (player = 0; player < SK_PLAYER_NUM; player++) {
+    if (host_toggles[player] != sketch_toggles[player]) {
+      printf("FAIL: autofire player %d: host saw %u of %u toggles\n",
+             player, host_toggles[player], sketch_toggles[player]);
+      failures++;
+    }
+  }
+  printf("autofire: %d players, %u toggles of %u ticks each, "
+         "%d failures\n", SK_PLAYER_NUM, sketch_toggles[0], phase_ticks,
+         failures);
+  return failures != 0;
+}
+
+/*
+ * Sketch and firmware: short taps. Every player taps button 1 for
+ * BENCH_TAP_MS at a time, a scan by default, the shortest the sketch can
+ * see; it may be raised at build time, as it must be for a sketch built
+ * without eager presses. The 16U2's replies are dropped, so the sketch
+ * keeps asking for a faster rate and holds its reports back for
+ * LINK_RETRY_MS at a time, and taps land both inside and between the
+ * holds. The host must see every tap pressed and released. Taps are spaced
+ * so no two fall in one hold, which would merge them.
+ */
+#ifndef BENCH_TAP_MS
+#define BENCH_TAP_MS            1
+#endif
+#define BENCH_TAP_SPACING_MS    150
+#define BENCH_TAP_RUN_MS        5000
+#define BENCH_TAP_BUTTON        0x01    /* Button 1 */
+
+static int check_taps(void)
+{
+  uint8_t host[SK_PLAYER_NUM];
+  uint16_t presses[SK_PLAYER_NUM];
+  uint8_t seen[SK_PLAYER_NUM][SK_STATE_SIZE];
+  uint8_t collected;
+  unsigned long tick, next = BENCH_SETTLE_MS, release = 0;
+  int player, taps = 0, failures = 0;
+
+  memset(host, 0, sizeof(host));
+  memset(presses, 0, sizeof(presses));
+  linked_init(false);
+
+  for (tick = 0; tick < BENCH_TAP_RUN_MS + BENCH_SETTLE_MS; tick++) {
+    if ((tick == next) && (tick < BENCH_TAP_RUN_MS)) {
+      for (player = 0; player < SK_PLAYER_NUM; player++) {
+        sk_set_inputs(player, BENCH_TAP_BUTTON << 4);
+      }
+      taps++;
+      release = tick + BENCH_TAP_MS;
+      next = tick + BENCH_TAP_SPACING_MS + rng() % BENCH_TAP_SPACING_MS;
+    } else if (tick == release) {
+      for (player = 0; player < SK_PLAYER_NUM; player++) {
+        sk_set_inputs(player, 0);
+      }
+    }
+
+    collected = run_linked_ms(seen);
+    for (player = 0; player < SK_PLAYER_NUM; player++) {
+      uint8_t pressed = state_buttons(seen[player]) & BENCH_TAP_BUTTON;
+
+      if ((collected & (1 << player)) && (pressed != host[player])) {
+        host[player] = pressed;
+        presses[player] += pressed ? 1 : 0;
+      }
+    }
+  }
+
+  for (player = 0; player < SK_PLAYER_NUM; player++) {
+    if ((presses[player] != taps) || host[player]) {
+      printf("FAIL: taps player %d: host saw %u of %d taps%s\n", player,
+             presses[player], taps, host[player] ? ", still pressed" : "");
+      failures++;
+    }
+  }
+  printf("taps: %d players, %d taps of %d ms, %d failures\n",
+         SK_PLAYER_NUM, taps, BENCH_TAP_MS, failures);
+  return failures != 0;
+}
+
+/*
+ * Firmware: report queues. A button tapped and released between two host
+ * polls must reach the host as a press, then a release. A burst of
+ * changes within one poll must reach the host in order, ending with the
+ * last, with every change either collected or counted as coalesced.
+ */
+#define BENCH_QUEUE_BURST       12
+#define BENCH_QUEUE_DRAIN_MS    20
+
+/* Set a player state's buttons, as state_buttons() reads them. */
+static void set_state_buttons(uint8_t state[SK_STATE_SIZE], uint8_t buttons)
+{
+#if COMPACT_REPORT
+  state[0] = (uint8_t)((state[0] & 0x0F) | (buttons << 4));
+  state[1] = (uint8_t)(buttons >> 4);
+#else
+  state[2] = buttons;
+#endif
+}
+
+/* Collect player 0's reports for a number of frames, as button states. */
+static int drain_reports(uint8_t *buttons, int max)
+{
+  uint8_t seen[SK_PLAYER_NUM][SK_STATE_SIZE];
+  int tick, count = 0;
+
+  for (tick = 0; tick < BENCH_QUEUE_DRAIN_MS; tick++) {
+    if ((run_frame(seen) & 1) && (count < max)) {
+      buttons[count++] = state_buttons(seen[0]);
+    }
+  }
+  return count;
+}
+
+static int check_report_queue(void)
+{
+  uint8_t states[SK_PLAYER_NUM * SK_STATE_SIZE];
+  uint8_t buttons[BENCH_QUEUE_BURST + 1];
+  fw_stats_t stats;
+  uint32_t coalesced;
+  int count, ix, failures = 0;
+
+  fw_set_tx_hook(NULL);
+  fw_init();
+  memset(states, 0, sizeof(states));
+
+  /* A tap shorter than a poll. */
+  set_state_buttons(states, 0x01);
+  fw_publish_state(states, sizeof(states));
+  set_state_buttons(states, 0x00);
+  fw_publish_state(states, sizeof(states));
+  count = drain_reports(buttons, BENCH_QUEUE_BURST);
+  if ((count != 2) || (buttons[0] != 0x01) || (buttons[1] != 0x00)) {
+    printf("FAIL: report queue: tap collected as %d reports\n", count);
+    failures++;
+  }
+
+  /* A burst, more than a queue holds. */
+  fw_stats(&stats);
+  coalesced = stats.reports_coalesced;
+  for (ix = 1; ix <= BENCH_QUEUE_BURST; ix++) {
+    set_state_buttons(states, (uint8_t)ix);
+    fw_publish_state(states, sizeof(states));
+  }
+  count = drain_reports(buttons, BENCH_QUEUE_BURST + 1);
+  fw_stats(&stats);
+  coalesced = stats.reports_coalesced - coalesced;
+  for (ix = 1; ix < count; ix++) {
+    if (buttons[ix] <= buttons[ix - 1]) {
+      printf("FAIL: report queue: burst out of order\n");
+      failures++;
+      break;
+    }
+  }
+  if ((count == 0) || (buttons[count - 1] != BENCH_QUEUE_BURST) ||
+      (count + coalesced != BENCH_QUEUE_BURST)) {
+    printf("FAIL: report queue: burst of %d collected as %d reports, %u "
+           "coalesced\n", BENCH_QUEUE_BURST, count, coalesced);
+    failures++;
+  }
+
+  printf("report queue: burst of %d collected as %d reports, %d failures\n",
+         BENCH_QUEUE_BURST, count, failures);
+  return failures != 0;
+}
+
+/*
+ * Firmware and sketch: link rate fallback. The 16U2 goes quiet once the
+ * link is up, as when it resets, and comes back. The sketch falls back to
+ * the safe rate and then renegotiates its target. A rate that fails as
+ * soon as it is reached is dropped a step instead, while the target itself
+ * is kept.
+ */
+#define BENCH_FALLBACK_RUN_MS   2000
+
+/* Run until the link rate is, or is not, the safe rate; returns it. */
+static uint8_t run_until_safe(bool safe)
+{
+  unsigned long ms;
+
+  for (ms = 0; (ms < BENCH_FALLBACK_RUN_MS) &&
+               ((sk_link_rate() == LINK_RATE_SAFE) != safe); ms++) {
+    run_linked_ms(NULL);
+  }
+  return sk_link_rate();
+}
+
+/*
+ * Silence the 16U2 until the sketch falls back, and for a while longer if
+ * away, then restart it.
+ */
+static void fallback_reset(bool away)
+{
+  fw_set_tx_hook(NULL);
+  run_until_safe(true);
+  if (away) {
+    run_linked(BENCH_FALLBACK_RUN_MS);
+  }
+  fw_init();
+  fw_set_tx_hook(firmware_to_sketch);
+}
+
+static int check_rate_fallback(void)
+{
+  sk_settings_t sketch;
+  uint8_t target, rate, step;
+  int failures = 0;
+
+  linked_init(true);
+  run_linked(BENCH_FALLBACK_RUN_MS);
+  sk_settings(&sketch);
+  target = sketch.link_rate_target;
+  if (sk_link_rate() != target) {
+    printf("FAIL: fallback: link at rate %u, not the target %u\n",
+           sk_link_rate(), target);
+    failures++;
+  }
+
+  /* Resets, brief and long, once the link has been up a while. */
+  fallback_reset(false);
+  run_linked(BENCH_FALLBACK_RUN_MS);
+  if (sk_link_rate() != target) {
+    printf("FAIL: fallback: at rate %u after a brief reset, not %u\n",
+           sk_link_rate(), target);
+    failures++;
+  }
+  fallback_reset(true);
+  run_linked(BENCH_FALLBACK_RUN_MS);
+  if (sk_link_rate() != target) {
+    printf("FAIL: fallback: at rate %u after a long reset, not %u\n",
+           sk_link_rate(), target);
+    failures++;
+  }
+
+  /* Every rate lost as soon as it is reached, down to the safe rate. */
+  linked_init(true);
+  for (step = 0; step < target - LINK_RATE_SAFE; step++) {
+    rate = run_until_safe(false);
+    if (rate != target - step) {
+      printf("FAIL: fallback: reached rate %u after %u failed rates, "
+             "not %u\n", rate, step, target - step);
+      failures++;
+    }
+    fallback_reset(false);
+  }
+  run_linked(BENCH_FALLBACK_RUN_MS);
+  sk_settings(&sketch);
+  if ((sk_link_rate() != LINK_RATE_SAFE) ||
+      (sketch.link_rate_target != target)) {
+    printf("FAIL: fallback: at rate %u aiming for %u after every rate "
+           "failed\n", sk_link_rate(), sketch.link_rate_target);
+    failures++;
+  }
+
+  /* Even then, a 16U2 that went away is tried at the target again. */
+  fallback_reset(true);
+  run_linked(BENCH_FALLBACK_RUN_MS);
+  if (sk_link_rate() != target) {
+    printf("FAIL: fallback: at rate %u after a long reset at the safe "
+           "rate, not %u\n", sk_link_rate(), target);
+    failures++;
+  }
+
+  printf("fallback: target rate %u, %u rates stepped down, %d failures\n",
+         target, target - LINK_RATE_SAFE, failures);
+  return failures != 0;
+}
+
+/*
+ * Firmware and sketch: runtime settings. The host reads the defaults, sets
+ * new ones, which the sketch must take up and the firmware must keep over
+ * a restart, and has settings that are out of range refused.
+ */
+#define BENCH_SETTINGS_SCAN_HZ  500
+#define BENCH_SETTINGS_DEBOUNCE 8       /* ms: 4 samples at 500 Hz */
+
+static int check_settings(void)
+{
+  link_settings_t settings, expected;
+  sk_settings_t sketch;
+  uint32_t writes;
+  int failures = 0;
+
+  linked_init(true);
+  run_linked(BENCH_SETTLE_MS);
+
+  /* Nothing stored yet, so every setting is at its default. */
+  link_settings_default(&expected);
+  if ((fw_control_request(VENDOR_REQTYPE_IN, VENDOR_REQ_GET_SETTINGS, 0, 0,
+                          &settings, sizeof(settings)) != sizeof(settings)) ||
+      (memcmp(&settings, &expected, sizeof(settings)) != 0)) {
+    printf("FAIL: settings: defaults not read back\n");
+    failures++;
+  }
+  sk_settings(&sketch);
+  if (!sketch.received) {
+    printf("FAIL: settings: the sketch was not sent the defaults\n");
+    failures++;
+  }
+
+  expected.link_rate = LINK_RATE_500K;
+  expected.scan_rate_hz = BENCH_SETTINGS_SCAN_HZ;
+  expected.debounce_ms = BENCH_SETTINGS_DEBOUNCE;
+  expected.report_mode = LINK_REPORT_DELTAS;
+  expected.idle_ms = 100;
+  if (fw_control_request(VENDOR_REQTYPE_OUT, VENDOR_REQ_SET_SETTINGS, 0, 0,
+                         &expected, sizeof(expected)) != 0) {
+    printf("FAIL: settings: valid settings refused\n");
+    failures++;
+  }
+  run_linked(BENCH_SETTLE_MS * 4);
+  writes = fw_eeprom_writes();
+
+  sk_settings(&sketch);
+  if ((sketch.scan_rate_hz != BENCH_SETTINGS_SCAN_HZ) ||
+      (sketch.debounce_samples != 4) || !sketch.delta_mode ||
+      (sketch.link_rate_target != LINK_RATE_500K) ||
+      (sk_link_rate() != LINK_RATE_500K)) {
+    printf("FAIL: settings: sketch at %u Hz, %u samples, delta mode %d, "
+           "link rate %u\n", sketch.scan_rate_hz, sketch.debounce_samples,
+           sketch.delta_mode, sk_link_rate());
+    failures++;
+  }
+
+  /* Kept over a restart, and storing them again writes nothing. */
+  fw_init();
+  if ((fw_control_request(VENDOR_REQTYPE_IN, VENDOR_REQ_GET_SETTINGS, 0, 0,
+                          &settings, sizeof(settings)) != sizeof(settings)) ||
+      (memcmp(&settings, &expected, sizeof(settings)) != 0)) {
+    printf("FAIL: settings: not kept over a restart\n");
+    failures++;
+  }
+  fw_control_request(VENDOR_REQTYPE_OUT, VENDOR_REQ_SET_SETTINGS, 0, 0,
+                     &expected, sizeof(expected));
+  fw_task();
+  if (fw_eeprom_writes() != writes) {
+    printf("FAIL: settings: unchanged settings written to EEPROM\n");
+    failures++;
+  }
+
+  settings = expected;
+  settings.scan_rate_hz = LINK_SCAN_RATE_MAX + 1;
+  if (fw_control_request(VENDOR_REQTYPE_OUT, VENDOR_REQ_SET_SETTINGS, 0, 0,
+                         &settings, sizeof(settings)) != -1) {
+    printf("FAIL: settings: out of range scan rate accepted\n");
+    failures++;
+  }
+  settings = expected;
+  settings.idle_ms = LINK_IDLE_MS_MAX + LINK_IDLE_MS_UNIT;
+  if (fw_control_request(VENDOR_REQTYPE_OUT, VENDOR_REQ_SET_SETTINGS, 0, 0,
+                         &settings, sizeof(settings)) != -1) {
+    printf("FAIL: settings: out of range idle rate accepted\n");
+    failures++;
+  }
+  settings = expected;
+  settings.idle_ms = expected.idle_ms + 1;
+  if (fw_control_request(VENDOR_REQTYPE_OUT, VENDOR_REQ_SET_SETTINGS, 0, 0,
+                         &settings, sizeof(settings)) != -1) {
+    printf("FAIL: settings: idle rate not in 4 ms units accepted\n");
+    failures++;
+  }
+  settings = expected;
+  settings.version = LINK_SETTINGS_VERSION + 1;
+  if (fw_control_request(VENDOR_REQTYPE_OUT, VENDOR_REQ_SET_SETTINGS, 0, 0,
+                         &settings, sizeof(settings)) != -1) {
+    printf("FAIL: settings: unknown version accepted\n");
+    failures++;
+  }
+
+  printf("settings: %u EEPROM bytes written, %d failures\n", writes,
+         failures);
+  return failures != 0;
+}
+
+/*
+ * Sketch: a shorter debounce time set while an input is settling. The
+ * release must be accepted the new settle time after the sketch takes up
+ * the settings, not once its counter has wrapped past the old count.
+ */
+#define BENCH_DEBOUNCE_LONG_MS  15
+#define BENCH_DEBOUNCE_SHORT_MS 4
+#define BENCH_DEBOUNCE_WAIT_MS  5
+#define BENCH_DEBOUNCE_INPUT    (1 << 4)        /* Button 1 */
+
+static int check_debounce_change(void)
+{
+  link_settings_t settings;
+  sk_settings_t sketch;
+  unsigned long ms;
+  int failures = 0;
+
+  linked_init(true);
+  link_settings_default(&settings);
+  settings.debounce_ms = BENCH_DEBOUNCE_LONG_MS;
+  fw_control_request(VENDOR_REQTYPE_OUT, VENDOR_REQ_SET_SETTINGS, 0, 0,
+                     &settings, sizeof(settings));
+  run_linked(BENCH_SETTLE_MS);
+
+  sk_set_inputs(0, BENCH_DEBOUNCE_INPUT);
+  run_linked(BENCH_SETTLE_MS);
+  sk_set_inputs(0, 0);
+  run_linked(BENCH_DEBOUNCE_WAIT_MS);
+
+  settings.debounce_ms = BENCH_DEBOUNCE_SHORT_MS;
+  fw_control_request(VENDOR_REQTYPE_OUT, VENDOR_REQ_SET_SETTINGS, 0, 0,
+                     &settings, sizeof(settings));
+  for (ms = 0; ms < BENCH_SETTLE_MS; ms++) {
+    sk_settings(&sketch);
+    if (sketch.debounce_samples ==
+        BENCH_DEBOUNCE_SHORT_MS * sketch.scan_rate_hz / 1000) {
+      break;
+    }
+    run_linked_ms(NULL);
+  }
+  for (ms = 0; (ms < BENCH_SETTLE_MS) &&
+               (sk_debounced(0) & BENCH_DEBOUNCE_INPUT); ms++) {
+    run_linked_ms(NULL);
+  }
+  if (ms > BENCH_DEBOUNCE_SHORT_MS) {
+    printf("FAIL: debounce change: release taken %lu ms after a %u ms "
+           "settle time\n", ms, BENCH_DEBOUNCE_SHORT_MS);
+    failures++;
+  }
+
+  printf("debounce change: release after %lu ms, %d failures\n", ms,
+         failures);
+  return failures != 0;
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long iterations = BENCH_ITERATIONS;
+  int failed = 0;
+
+  if (argc > 1) {
+    iterations = strtoul(argv[1], NULL, 0);
+  }
+
+  calibrate();
+
+  printf("%-32s %10s %10s %10s\n", "benchmark", "calls", "ns/call",
+         "Mcalls/s");
+  bench_sketch(iterations);
+  failed |= check_port_decode();
+  failed |= check_input_remap(iterations);
+  failed |= check_link_framing();
+  bench_uart(iterations);
+  bench_reports(iterations);
+#if ANALOG_AXES
+  failed |= check_analog_axes();
+#else
+  printf("analog: skipped, built without ANALOG_AXES\n");
+#endif
+  failed |= bench_end_to_end(BENCH_E2E_MS);
+  failed |= check_link_stats();
+  failed |= check_idle_rates();
+  failed |= check_autofire();
+  failed |= check_taps();
+  failed |= check_report_queue();
+  failed |= check_rate_fallback();
+  failed |= check_settings();
+  failed |= check_debounce_change();
+  return failed;
+}
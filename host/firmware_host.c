@@ -0,0 +1,174 @@
+/*
+ * Host build of the USB firmware (see harness.h).
+ */
+
+#include "../firmwares/multiplayer_joystick/multiplayer_joystick.c"
+
+#include "harness.h"
+
+#if (PLAYER_NUM != SK_PLAYER_NUM) || (LINK_PLAYER_STATE_SIZE != SK_STATE_SIZE)
+#error "harness.h does not match the firmware"
+#endif
+
+/* Link timer ticks are 4 microseconds; the remainder is carried over. */
+static uint32_t fw_timer_us;
+
+void fw_init(void)
+{
+    firmware_init();
+
+    USB_DeviceState = DEVICE_STATE_Configured;
+    EVENT_USB_Device_ConfigurationChanged();
+}
+
+void fw_task(void)
+{
+    firmware_task();
+    firmware_sleep();
+}
+
+void fw_uart_rx(uint8_t byte)
+{
+    /* A clean receive; the transmit flags are left as they are. */
+    UCSR1A = (UCSR1A & ((1 << TXC1) | (1 << U2X1))) | (1 << RXC1);
+    UDR1 = byte;
+    USART1_RX_vect();
+}
+
+void fw_uart_rx_error(uint8_t byte, uint8_t errors)
+{
+    UCSR1A = (UCSR1A & ((1 << TXC1) | (1 << U2X1))) | (1 << RXC1) |
+             ((errors & FW_UART_FRAME_ERROR) ? (1 << FE1) : 0) |
+             ((errors & FW_UART_OVERRUN) ? (1 << DOR1) : 0) |
+             ((errors & FW_UART_PARITY_ERROR) ? (1 << UPE1) : 0);
+    UDR1 = byte;
+    USART1_RX_vect();
+}
+
+void fw_link_rx_task(void)
+{
+    link_rx_task();
+}
+
+void fw_sof(void)
+{
+    EVENT_USB_Device_StartOfFrame();
+}
+
+void fw_interface_report(void)
+{
+    interface_report();
+}
+
+void fw_publish_state(const uint8_t *states, uint8_t len)
+{
+#if COMPACT_REPORT
+    uint8_t payload[LINK_STATE_PAYLOAD_SIZE(PLAYER_NUM)];
+
+    len = link_states_pack(states, len / SK_STATE_SIZE, payload);
+    states = payload;
+#endif
+    link_frame_receive(LINK_FRAME_STATE, states, len);
+}
+
+void fw_advance_us(uint32_t us)
+{
+    fw_timer_us += us;
+    TCNT1 += (uint16_t)(fw_timer_us / 4);
+    fw_timer_us %= 4;
+}
+
+void fw_set_tx_hook(void (*hook)(uint8_t byte))
+{
+    mock_serial_send_hook = hook;
+}
+
+uint8_t fw_host_poll(uint8_t reports[][SK_STATE_SIZE])
+{
+    uint8_t seen = 0;
+
+    for (int if_ix = 0; if_ix < HID_IF_NUM; if_ix++) {
+        Endpoint_state_t *ep_ptr = &Ep_state[if_ix];
+        uint8_t packet[MOCK_ENDPOINT_BANK_SIZE];
+        uint8_t player_ix = ep_ptr->first_player;
+        uint8_t *data = packet;
+        uint8_t len;
+
+        len = mock_endpoint_host_poll(ep_ptr->ep_num, packet);
+        if (len == 0) {
+            continue;
+        }
+
+        /* A shared interface's reports lead with the player's report ID. */
+        if (ep_ptr->players > 1) {
+            player_ix += *data++ - 1;
+            len--;
+        }
+        if (reports && (len == SK_STATE_SIZE)) {
+            memcpy(reports[player_ix], data, SK_STATE_SIZE);
+        }
+        seen |= (uint8_t)(1 << player_ix);
+    }
+    return seen;
+}
+
+void fw_stats(fw_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->frames = link_decoder.frames;
+    stats->crc_errors = link_decoder.crc_errors;
+    stats->framing_errors = link_decoder.framing_errors;
+    stats->lost_frames = link_decoder.lost_frames;
+    stats->rx_overflows = link_rx_overflows;
+    stats->link_rate = link_rate;
+    for (int if_ix = 0; if_ix < HID_IF_NUM; if_ix++) {
+        stats->reports_sent += Ep_state[if_ix].reports_sent;
+        stats->naked_polls += Ep_state[if_ix].naked_polls;
+        stats->reports_coalesced += Ep_state[if_ix].reports_coalesced;
+    }
+    stats->report_age_max = Report_age.max;
+    stats->report_age_count = Report_age.count;
+}
+
+int fw_control_request(uint8_t type, uint8_t request, uint16_t value,
+                       uint16_t index, void *data, uint16_t len)
+{
+    mock_endpoint_t *ep = &mock_endpoints[ENDPOINT_CONTROLEP];
+    uint8_t prev_ep = Endpoint_GetCurrentEndpoint();
+    int result = 0;
+
+    USB_ControlRequest.bmRequestType = type;
+    USB_ControlRequest.bRequest = request;
+    USB_ControlRequest.wValue = value;
+    USB_ControlRequest.wIndex = index;
+    USB_ControlRequest.wLength = len;
+    mock_control_out = (type & REQDIR_DEVICETOHOST) ? NULL : data;
+    mock_control_out_len = len;
+    mock_control_stalled = false;
+
+    Endpoint_SelectEndpoint(ENDPOINT_CONTROLEP);
+    EVENT_USB_Device_ControlRequest();
+    Endpoint_SelectEndpoint(prev_ep);
+
+    if (mock_control_stalled) {
+        result = -1;
+    } else if (type & REQDIR_DEVICETOHOST) {
+        result = (ep->len[0] < len) ? ep->len[0] : len;
+        memcpy(data, ep->bank[0], result);
+    }
+    ep->len[0] = 0;
+    ep->armed = 0;
+    ep->first = 0;
+    mock_control_out = NULL;
+    return result;
+}
+
+uint32_t fw_eeprom_writes(void)
+{
+    return mock_eeprom_writes;
+}
+
+uint8_t fw_interface_players(uint8_t if_ix)
+{
+    return (if_ix < HID_IF_NUM) ? Ep_state[if_ix].players : 0;
+}
@@ -0,0 +1,189 @@
+/*
+ * Host build harness interface.
+ *
+ * The sketch and the USB firmware are each built, unmodified, into one
+ * host binary against the mock Arduino core and mock LUFA in mock/. Their
+ * registers are private to their own translation units, as they are on
+ * their own chips, so each is driven through the wrappers declared here.
+ */
+
+#ifndef _HARNESS_H_
+#define _HARNESS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "players.h"
+#include "serial_link.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Sketch (sketch_host.cpp).
+ */
+
+#define SK_PLAYER_NUM       PLAYER_NUM
+#define SK_STATE_SIZE       LINK_PLAYER_STATE_SIZE
+
+void sk_setup(void);
+
+/* Set a player's raw inputs, one bit per pin as in port_scan.h. */
+void sk_set_inputs(uint8_t player, uint16_t inputs);
+
+/*
+ * Port decoding, against the Arduino core. sk_set_port() sets a port's
+ * PINx register, ports numbered as in port_scan.h: A to H, J, L.
+ * sk_read_ports() samples and decodes the registers as the sketch's scan
+ * does. sk_digital_read() reads each player's pins with digitalRead(), one
+ * at a time, as the sketch did before port snapshots. Both give every
+ * player's input word, and return false with INPUT_SHIFT_REGISTERS.
+ */
+#define SK_PORT_NUM         10
+
+void sk_set_port(uint8_t port, uint8_t pins);
+bool sk_read_ports(uint16_t inputs[SK_PLAYER_NUM]);
+bool sk_digital_read(uint16_t inputs[SK_PLAYER_NUM]);
+
+/*
+ * Set the voltages on a player's analog stick, as 10-bit ADC readings.
+ * Only used with ANALOG_AXES.
+ */
+void sk_set_analog(uint8_t player, uint16_t x, uint16_t y);
+
+/*
+ * Raise the scan timer interrupt and run one pass of loop(). With
+ * ANALOG_AXES, the ADC conversions of one scan period complete first.
+ */
+void sk_tick(void);
+
+/*
+ * Remap an input word through the shift layers (see input_remap.h), by
+ * table or, with by_bit, one input at a time straight from the layer
+ * definitions. Returns false, leaving the word as it is, without
+ * INPUT_REMAP.
+ */
+bool sk_remap(uint16_t *inputs, bool by_bit);
+
+/*
+ * Length of each autofire phase of a player's button, in scan ticks, or 0
+ * if the button does not autofire or the sketch is built without AUTOFIRE.
+ */
+uint16_t sk_autofire_ticks(uint8_t player, uint8_t button);
+
+/* Settings in effect in the sketch, after any from the 16U2. */
+typedef struct sk_settings_t_ {
+  uint16_t scan_rate_hz;
+  uint8_t  debounce_samples;
+  uint8_t  link_rate_target;
+  bool     delta_mode;
+  bool     received;
+} sk_settings_t;
+
+void sk_settings(sk_settings_t *settings);
+
+/* Run update_joystick_state() for every player. */
+void sk_update_joystick_states(void);
+
+/* Copy out a player's current joystick state. */
+void sk_state(uint8_t player, uint8_t state[SK_STATE_SIZE]);
+
+/* A player's debounced inputs, one bit per pin as sk_set_inputs() takes. */
+uint16_t sk_debounced(uint8_t player);
+
+uint8_t sk_link_rate(void);
+
+/* Forward the sketch's serial output, or drop it when hook is NULL. */
+void sk_set_tx_hook(void (*hook)(uint8_t byte));
+
+/* Queue a byte for the sketch's serial input. */
+void sk_serial_rx(uint8_t byte);
+
+/*
+ * USB firmware (firmware_host.c).
+ */
+
+typedef struct fw_stats_t_ {
+  uint16_t frames;
+  uint16_t crc_errors;
+  uint16_t framing_errors;
+  uint16_t lost_frames;
+  uint16_t rx_overflows;
+  uint8_t  link_rate;
+  uint32_t reports_sent;
+  uint32_t naked_polls;
+  uint32_t reports_coalesced;
+  uint16_t report_age_max;
+  uint16_t report_age_count;
+} fw_stats_t;
+
+/* Initialise the firmware and bring the device to the configured state. */
+void fw_init(void);
+
+/* Run one pass of the main loop, including its sleep, which returns at
+ * once.
+ */
+void fw_task(void);
+
+/* Deliver a byte to the USART receive interrupt. */
+void fw_uart_rx(uint8_t byte);
+
+/* Deliver a byte received with errors, a set of FW_UART_ flags. */
+#define FW_UART_FRAME_ERROR     0x01
+#define FW_UART_OVERRUN         0x02
+#define FW_UART_PARITY_ERROR    0x04
+
+void fw_uart_rx_error(uint8_t byte, uint8_t errors);
+
+/* Drain the receive queue through the frame decoder. */
+void fw_link_rx_task(void);
+
+/* Raise the USB start of frame event. */
+void fw_sof(void);
+
+/* Run one pass of the per-interface report task. */
+void fw_interface_report(void);
+
+/*
+ * Publish a full set of reports, as a state frame from the link would.
+ * The states are SK_STATE_SIZE bytes per player; with COMPACT_REPORT they
+ * are packed into the frame's layout first.
+ */
+void fw_publish_state(const uint8_t *states, uint8_t len);
+
+/* Advance the free-running link timer. */
+void fw_advance_us(uint32_t us);
+
+/* Forward the firmware's serial output, or drop it when hook is NULL. */
+void fw_set_tx_hook(void (*hook)(uint8_t byte));
+
+/*
+ * Play the host polling every interface endpoint. Each report collected is
+ * stored under its player; returns the players whose reports were
+ * collected, one bit each. A report may be all zero bytes, so only the
+ * returned bits tell which were.
+ */
+uint8_t fw_host_poll(uint8_t reports[][SK_STATE_SIZE]);
+
+void fw_stats(fw_stats_t *stats);
+
+/* Number of players carried by an interface, 0 past the last. */
+uint8_t fw_interface_players(uint8_t if_ix);
+
+/*
+ * Play the host making a control request. OUT data is sent from data, and
+ * IN data is copied to it. Returns the number of bytes returned by an IN
+ * request (0 for OUT), or -1 if the request was stalled.
+ */
+int fw_control_request(uint8_t type, uint8_t request, uint16_t value,
+                       uint16_t index, void *data, uint16_t len);
+
+/* Number of EEPROM byte writes since power-up. */
+uint32_t fw_eeprom_writes(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HARNESS_H_ */
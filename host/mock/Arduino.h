@@ -0,0 +1,74 @@
+/*
+ * Host build mock of the Arduino core, as far as the sketch uses it.
+ *
+ * Pin configuration calls are accepted and ignored; the harness drives the
+ * inputs through the PINx registers, as port_scan.h reads them.
+ * digitalRead() reads them as the core does, through the Mega's pin tables
+ * (see pins_arduino.h). It is inline, as the registers are per translation
+ * unit (see avr/io.h), so that it reads the sketch's. Serial
+ * output goes to mock_arduino_tx_hook, and input is queued with
+ * mock_arduino_rx().
+ */
+
+#ifndef _MOCK_ARDUINO_H_
+#define _MOCK_ARDUINO_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "pins_arduino.h"
+
+#define INPUT   0x0
+#define OUTPUT  0x1
+#define LOW     0x0
+#define HIGH    0x1
+#define DEC     10
+#define HEX     16
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+
+static inline int digitalRead(uint8_t pin)
+{
+  uint8_t port = (pin < NUM_DIGITAL_PINS) ? digitalPinToPort(pin) : NOT_A_PORT;
+
+  if (port == NOT_A_PORT) {
+    return LOW;
+  }
+  return (*portInputRegister(port) & digitalPinToBitMask(pin)) ? HIGH : LOW;
+}
+
+unsigned long millis(void);
+void delay(unsigned long ms);
+
+#define MOCK_SERIAL_RX_SIZE 1024
+
+class MockSerial {
+public:
+  void begin(unsigned long baud);
+  void end(void);
+  void flush(void);
+  int available(void);
+  int read(void);
+  size_t write(uint8_t byte);
+  size_t write(const uint8_t *buffer, size_t size);
+  size_t print(const char *str);
+  size_t print(long value, int base = DEC);
+  size_t println(const char *str);
+  size_t println(long value, int base = DEC);
+  size_t println(void);
+
+  unsigned long baud;
+};
+
+extern MockSerial Serial;
+
+extern void (*mock_arduino_tx_hook)(uint8_t byte);
+void mock_arduino_rx(uint8_t byte);
+
+#endif /* _MOCK_ARDUINO_H_ */
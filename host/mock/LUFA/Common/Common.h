@@ -0,0 +1,20 @@
+/* Host build mock of <LUFA/Common/Common.h>. */
+
+#ifndef _MOCK_LUFA_COMMON_H_
+#define _MOCK_LUFA_COMMON_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#define ATTR_WARN_UNUSED_RESULT     __attribute__((warn_unused_result))
+#define ATTR_NON_NULL_PTR_ARG(...)  __attribute__((nonnull(__VA_ARGS__)))
+#define ATTR_NOINLINE               __attribute__((noinline))
+#define ATTR_ALWAYS_INLINE          __attribute__((always_inline))
+#define ATTR_PACKED                 __attribute__((packed))
+
+#define GlobalInterruptEnable()
+#define GlobalInterruptDisable()
+
+#endif /* _MOCK_LUFA_COMMON_H_ */
@@ -0,0 +1,13 @@
+/* Host build mock of <LUFA/Drivers/Board/LEDs.h>. */
+
+#ifndef _MOCK_LUFA_LEDS_H_
+#define _MOCK_LUFA_LEDS_H_
+
+#define LEDS_LED1               (1 << 0)
+#define LEDS_LED2               (1 << 1)
+
+#define LEDs_Init()
+#define LEDs_TurnOnLEDs(mask)
+#define LEDs_TurnOffLEDs(mask)
+
+#endif /* _MOCK_LUFA_LEDS_H_ */
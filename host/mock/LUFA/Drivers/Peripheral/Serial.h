@@ -0,0 +1,22 @@
+/* Host build mock of <LUFA/Drivers/Peripheral/Serial.h>. */
+
+#ifndef _MOCK_LUFA_SERIAL_H_
+#define _MOCK_LUFA_SERIAL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../../../mock_lufa.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void Serial_Init(const uint32_t BaudRate, const bool DoubleSpeed);
+void Serial_SendByte(const char DataByte);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MOCK_LUFA_SERIAL_H_ */
@@ -0,0 +1,6 @@
+/* Host build mock of <LUFA/Drivers/USB/Class/CDCClass.h>. Unused. */
+
+#ifndef _MOCK_LUFA_CDCCLASS_H_
+#define _MOCK_LUFA_CDCCLASS_H_
+
+#endif /* _MOCK_LUFA_CDCCLASS_H_ */
@@ -0,0 +1,41 @@
+/* Host build mock of <LUFA/Drivers/USB/Class/HIDClass.h>. */
+
+#ifndef _MOCK_LUFA_HIDCLASS_H_
+#define _MOCK_LUFA_HIDCLASS_H_
+
+#include "../USB.h"
+
+#define HID_CSCP_HIDClass           0x03
+#define HID_CSCP_NonBootSubclass    0x00
+#define HID_CSCP_NonBootProtocol    0x00
+
+#define HID_DTYPE_HID               0x21
+#define HID_DTYPE_Report            0x22
+
+#define HID_REQ_GetReport           0x01
+#define HID_REQ_GetIdle             0x02
+#define HID_REQ_GetProtocol         0x03
+#define HID_REQ_SetReport           0x09
+#define HID_REQ_SetIdle             0x0A
+#define HID_REQ_SetProtocol         0x0B
+
+#define HID_REPORT_ITEM_In          0
+#define HID_REPORT_ITEM_Out         1
+#define HID_REPORT_ITEM_Feature     2
+
+typedef struct {
+    USB_Descriptor_Header_t Header;
+    uint16_t HIDSpec;
+    uint8_t  CountryCode;
+    uint8_t  TotalReportDescriptors;
+    uint8_t  HIDReportType;
+    uint16_t HIDReportLength;
+} ATTR_PACKED USB_HID_Descriptor_HID_t;
+
+typedef uint8_t USB_Descriptor_HIDReport_Datatype_t;
+
+typedef struct {
+    uint8_t InterfaceNumber;
+} USB_ClassInfo_HID_Device_t;
+
+#endif /* _MOCK_LUFA_HIDCLASS_H_ */
@@ -0,0 +1,173 @@
+/*
+ * Host build mock of <LUFA/Drivers/USB/USB.h>.
+ *
+ * Descriptor types and constants match LUFA; the endpoint functions are
+ * implemented against the endpoint model in mock_lufa.c.
+ */
+
+#ifndef _MOCK_LUFA_USB_H_
+#define _MOCK_LUFA_USB_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "../../Common/Common.h"
+#include "../../../mock_lufa.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Device states. */
+enum USB_Device_States_t {
+    DEVICE_STATE_Unattached = 0,
+    DEVICE_STATE_Powered,
+    DEVICE_STATE_Default,
+    DEVICE_STATE_Addressed,
+    DEVICE_STATE_Configured,
+    DEVICE_STATE_Suspended,
+};
+
+/* Control requests. */
+typedef struct {
+    uint8_t  bmRequestType;
+    uint8_t  bRequest;
+    uint16_t wValue;
+    uint16_t wIndex;
+    uint16_t wLength;
+} ATTR_PACKED USB_Request_Header_t;
+
+#define REQDIR_HOSTTODEVICE         (0 << 7)
+#define REQDIR_DEVICETOHOST         (1 << 7)
+#define REQTYPE_STANDARD            (0 << 5)
+#define REQTYPE_CLASS               (1 << 5)
+#define REQTYPE_VENDOR              (2 << 5)
+#define REQREC_DEVICE               (0 << 0)
+#define REQREC_INTERFACE            (1 << 0)
+#define REQREC_ENDPOINT             (2 << 0)
+#define CONTROL_REQTYPE_DIRECTION   0x80
+#define CONTROL_REQTYPE_TYPE        0x60
+#define CONTROL_REQTYPE_RECIPIENT   0x1F
+
+/* Endpoints. */
+#define ENDPOINT_DIR_OUT            0x00
+#define ENDPOINT_DIR_IN             0x80
+#define ENDPOINT_EPNUM_MASK         0x0F
+#define ENDPOINT_CONTROLEP          0
+#define EP_TYPE_CONTROL             0x00
+#define EP_TYPE_ISOCHRONOUS         0x01
+#define EP_TYPE_BULK                0x02
+#define EP_TYPE_INTERRUPT           0x03
+#define ENDPOINT_ATTR_NO_SYNC       (0 << 2)
+#define ENDPOINT_USAGE_DATA         (0 << 4)
+
+/* Descriptors. */
+#define VERSION_BCD(Major, Minor, Revision) \
+    ((((Major) & 0xFF) << 8) | (((Minor) & 0x0F) << 4) | ((Revision) & 0x0F))
+#define NO_DESCRIPTOR               0
+#define FIXED_CONTROL_ENDPOINT_SIZE 8
+#define FIXED_NUM_CONFIGURATIONS    1
+#define USB_CONFIG_ATTR_RESERVED    0x80
+#define USB_CONFIG_POWER_MA(mA)     ((mA) >> 1)
+#define USB_STRING_LEN(UnicodeChars) \
+    (sizeof(USB_Descriptor_Header_t) + ((UnicodeChars) << 1))
+#define LANGUAGE_ID_ENG             0x0409
+
+enum USB_DescriptorTypes_t {
+    DTYPE_Device        = 0x01,
+    DTYPE_Configuration = 0x02,
+    DTYPE_String        = 0x03,
+    DTYPE_Interface     = 0x04,
+    DTYPE_Endpoint      = 0x05,
+};
+
+typedef struct {
+    uint8_t Size;
+    uint8_t Type;
+} ATTR_PACKED USB_Descriptor_Header_t;
+
+typedef struct {
+    USB_Descriptor_Header_t Header;
+    uint16_t USBSpecification;
+    uint8_t  Class;
+    uint8_t  SubClass;
+    uint8_t  Protocol;
+    uint8_t  Endpoint0Size;
+    uint16_t VendorID;
+    uint16_t ProductID;
+    uint16_t ReleaseNumber;
+    uint8_t  ManufacturerStrIndex;
+    uint8_t  ProductStrIndex;
+    uint8_t  SerialNumStrIndex;
+    uint8_t  NumberOfConfigurations;
+} ATTR_PACKED USB_Descriptor_Device_t;
+
+typedef struct {
+    USB_Descriptor_Header_t Header;
+    uint16_t TotalConfigurationSize;
+    uint8_t  TotalInterfaces;
+    uint8_t  ConfigurationNumber;
+    uint8_t  ConfigurationStrIndex;
+    uint8_t  ConfigAttributes;
+    uint8_t  MaxPowerConsumption;
+} ATTR_PACKED USB_Descriptor_Configuration_Header_t;
+
+typedef struct {
+    USB_Descriptor_Header_t Header;
+    uint8_t InterfaceNumber;
+    uint8_t AlternateSetting;
+    uint8_t TotalEndpoints;
+    uint8_t Class;
+    uint8_t SubClass;
+    uint8_t Protocol;
+    uint8_t InterfaceStrIndex;
+} ATTR_PACKED USB_Descriptor_Interface_t;
+
+typedef struct {
+    USB_Descriptor_Header_t Header;
+    uint8_t  EndpointAddress;
+    uint8_t  Attributes;
+    uint16_t EndpointSize;
+    uint8_t  PollingIntervalMS;
+} ATTR_PACKED USB_Descriptor_Endpoint_t;
+
+typedef struct {
+    USB_Descriptor_Header_t Header;
+    uint16_t UnicodeString[];
+} ATTR_PACKED USB_Descriptor_String_t;
+
+/* Device stack state, set by the harness. */
+extern USB_Request_Header_t USB_ControlRequest;
+extern volatile uint8_t USB_DeviceState;
+
+void USB_Init(void);
+void USB_USBTask(void);
+void USB_Device_EnableSOFEvents(void);
+void USB_Device_DisableSOFEvents(void);
+
+/* Endpoint access. */
+bool Endpoint_ConfigureEndpoint(const uint8_t Address, const uint8_t Type,
+                                const uint16_t Size, const uint8_t Banks);
+void Endpoint_SelectEndpoint(const uint8_t Address);
+uint8_t Endpoint_GetCurrentEndpoint(void);
+bool Endpoint_IsINReady(void);
+bool Endpoint_IsReadWriteAllowed(void);
+void Endpoint_ClearIN(void);
+void Endpoint_ClearOUT(void);
+void Endpoint_ClearSETUP(void);
+void Endpoint_ClearStatusStage(void);
+void Endpoint_StallTransaction(void);
+void Endpoint_Write_8(const uint8_t Data);
+void Endpoint_Write_16_LE(const uint16_t Data);
+uint8_t Endpoint_Write_Stream_LE(const void* const Buffer, uint16_t Length,
+                                 uint16_t* const BytesProcessed);
+uint8_t Endpoint_Write_Control_Stream_LE(const void* const Buffer,
+                                         uint16_t Length);
+uint8_t Endpoint_Read_Control_Stream_LE(void* const Buffer, uint16_t Length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MOCK_LUFA_USB_H_ */
@@ -0,0 +1,8 @@
+/* Host build mock of <LUFA/Version.h>. */
+
+#ifndef _MOCK_LUFA_VERSION_H_
+#define _MOCK_LUFA_VERSION_H_
+
+#define LUFA_VERSION_STRING "host-mock"
+
+#endif /* _MOCK_LUFA_VERSION_H_ */
@@ -0,0 +1,40 @@
+/*
+ * Host build mock of <avr/eeprom.h>: the 16U2's 512 bytes of EEPROM,
+ * erased to all ones, private to the translation unit like the registers.
+ */
+
+#ifndef _MOCK_AVR_EEPROM_H_
+#define _MOCK_AVR_EEPROM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define MOCK_EEPROM_SIZE    512
+
+static uint8_t mock_eeprom[MOCK_EEPROM_SIZE] = {
+  [0 ... MOCK_EEPROM_SIZE - 1] = 0xFF,
+};
+
+/* Bytes actually written, as eeprom_update_block() skips equal ones. */
+static uint32_t mock_eeprom_writes;
+
+static inline void eeprom_read_block(void *dst, const void *src, size_t n)
+{
+  memcpy(dst, &mock_eeprom[(uintptr_t)src], n);
+}
+
+static inline void eeprom_update_block(const void *src, void *dst, size_t n)
+{
+  const uint8_t *data = (const uint8_t *)src;
+  size_t ix;
+
+  for (ix = 0; ix < n; ix++) {
+    if (mock_eeprom[(uintptr_t)dst + ix] != data[ix]) {
+      mock_eeprom[(uintptr_t)dst + ix] = data[ix];
+      mock_eeprom_writes++;
+    }
+  }
+}
+
+#endif /* _MOCK_AVR_EEPROM_H_ */
@@ -0,0 +1,24 @@
+/*
+ * Host build mock of <avr/interrupt.h>.
+ *
+ * An ISR becomes an ordinary function with the vector's name, which the
+ * host harness calls to simulate the interrupt.
+ */
+
+#ifndef _MOCK_AVR_INTERRUPT_H_
+#define _MOCK_AVR_INTERRUPT_H_
+
+#ifdef __cplusplus
+#define ISR(vector, ...)    extern "C" void vector(void); void vector(void)
+#else
+#define ISR(vector, ...)    void vector(void); void vector(void)
+#endif
+
+/* Nothing calls an empty interrupt, so it stays private to its chip. */
+#define EMPTY_INTERRUPT(vector)                                             \
+  static void __attribute__((unused)) vector(void) {}
+
+#define sei()
+#define cli()
+
+#endif /* _MOCK_AVR_INTERRUPT_H_ */
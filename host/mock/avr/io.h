@@ -0,0 +1,110 @@
+/*
+ * Host build mock of <avr/io.h>.
+ *
+ * Registers are plain variables. They are static, so the sketch and the
+ * firmware, built as separate translation units into one binary, each get
+ * their own set, as they would on their own chips. The USB controller
+ * registers are the exception: they belong to the mock LUFA endpoint
+ * layer (see mock_lufa.h).
+ *
+ * Select the chip with __AVR_ATmega2560__ or __AVR_ATmega16U2__.
+ */
+
+#ifndef _MOCK_AVR_IO_H_
+#define _MOCK_AVR_IO_H_
+
+#include <stdint.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#define _BV(bit)            (1 << (bit))
+
+#define MOCK_REG8(name)     static volatile uint8_t name
+#define MOCK_REG16(name)    static volatile uint16_t name
+
+/* Timer1, common to both chips. */
+MOCK_REG8(TCCR1A);
+MOCK_REG8(TCCR1B);
+MOCK_REG8(TIMSK1);
+MOCK_REG8(TIFR1);
+MOCK_REG16(TCNT1);
+MOCK_REG16(OCR1A);
+
+#define WGM12   3
+#define CS12    2
+#define CS11    1
+#define CS10    0
+#define OCIE1A  1
+#define OCF1A   1
+
+#if defined(__AVR_ATmega2560__)
+
+MOCK_REG8(PINA);
+MOCK_REG8(PINB);
+MOCK_REG8(PINC);
+MOCK_REG8(PIND);
+MOCK_REG8(PINE);
+MOCK_REG8(PINF);
+MOCK_REG8(PING);
+MOCK_REG8(PINH);
+MOCK_REG8(PINJ);
+MOCK_REG8(PINK);
+MOCK_REG8(PINL);
+
+/* ADC, for analog_axes.h; the harness plays the conversions. */
+MOCK_REG8(ADMUX);
+MOCK_REG8(ADCSRA);
+MOCK_REG8(ADCSRB);
+MOCK_REG16(ADC);
+MOCK_REG8(DIDR0);
+MOCK_REG8(DIDR2);
+
+#define REFS0   6
+#define ADEN    7
+#define ADSC    6
+#define ADIE    3
+#define ADPS2   2
+#define ADPS1   1
+#define ADPS0   0
+#define MUX5    3
+
+#ifdef __cplusplus
+/* SPI port and shift-register chain, for shift_scan.h. */
+#include "mock_spi.h"
+#endif
+
+#elif defined(__AVR_ATmega16U2__)
+
+MOCK_REG8(MCUSR);
+MOCK_REG8(UCSR1A);
+MOCK_REG8(UCSR1B);
+MOCK_REG8(UCSR1C);
+MOCK_REG8(UDR1);
+
+#define WDRF    3
+#define RXC1    7
+#define TXC1    6
+#define UDRE1   5
+#define FE1     4
+#define DOR1    3
+#define UPE1    2
+#define U2X1    1
+#define RXCIE1  7
+#define TXEN1   3
+#define RXEN1   4
+
+/* USB endpoint interrupt flags, for the selected endpoint. */
+#include "mock_lufa.h"
+#define UEINTX  (mock_endpoint_ueintx[mock_endpoint_selected & 0x0F])
+
+#define NAKINI  6
+#define RWAL    5
+#define TXINI   0
+
+#else
+#error "Define __AVR_ATmega2560__ or __AVR_ATmega16U2__ for the host build"
+#endif
+
+#endif /* _MOCK_AVR_IO_H_ */
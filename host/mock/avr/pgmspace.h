@@ -0,0 +1,13 @@
+/* Host build mock of <avr/pgmspace.h>: program memory is ordinary memory. */
+
+#ifndef _MOCK_AVR_PGMSPACE_H_
+#define _MOCK_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+
+#define PROGMEM
+#define pgm_read_byte(addr)     (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)     (*(const uint16_t *)(addr))
+#define pgm_read_ptr(addr)      (*(const void * const *)(addr))
+
+#endif /* _MOCK_AVR_PGMSPACE_H_ */
@@ -0,0 +1,6 @@
+/* Host build mock of <avr/power.h>. */
+
+#ifndef _MOCK_AVR_POWER_H_
+#define _MOCK_AVR_POWER_H_
+
+#endif /* _MOCK_AVR_POWER_H_ */
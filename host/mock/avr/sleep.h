@@ -0,0 +1,16 @@
+/*
+ * Host build mock of <avr/sleep.h>. Sleeping returns at once; the harness
+ * drives the main loop itself and never sleeps it.
+ */
+
+#ifndef _MOCK_AVR_SLEEP_H_
+#define _MOCK_AVR_SLEEP_H_
+
+#define SLEEP_MODE_IDLE         0
+
+#define set_sleep_mode(mode)
+#define sleep_enable()
+#define sleep_disable()
+#define sleep_cpu()
+
+#endif /* _MOCK_AVR_SLEEP_H_ */
@@ -0,0 +1,8 @@
+/* Host build mock of <avr/wdt.h>. */
+
+#ifndef _MOCK_AVR_WDT_H_
+#define _MOCK_AVR_WDT_H_
+
+#define wdt_disable()
+
+#endif /* _MOCK_AVR_WDT_H_ */
@@ -0,0 +1,122 @@
+/*
+ * Host build mock of the Arduino core (see Arduino.h).
+ */
+
+#include <stdio.h>
+
+#include "Arduino.h"
+
+MockSerial Serial;
+void (*mock_arduino_tx_hook)(uint8_t byte);
+
+static uint8_t rx_buffer[MOCK_SERIAL_RX_SIZE];
+static uint16_t rx_head;
+static uint16_t rx_tail;
+static unsigned long mock_millis;
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  (void)pin;
+  (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  (void)pin;
+  (void)val;
+}
+
+unsigned long millis(void)
+{
+  return mock_millis;
+}
+
+void delay(unsigned long ms)
+{
+  mock_millis += ms;
+}
+
+void mock_arduino_rx(uint8_t byte)
+{
+  uint16_t next = (rx_head + 1) % MOCK_SERIAL_RX_SIZE;
+
+  /* Drop on overflow, as the core's receive buffer does. */
+  if (next != rx_tail) {
+    rx_buffer[rx_head] = byte;
+    rx_head = next;
+  }
+}
+
+void MockSerial::begin(unsigned long rate)
+{
+  baud = rate;
+}
+
+void MockSerial::end(void)
+{
+}
+
+void MockSerial::flush(void)
+{
+}
+
+int MockSerial::available(void)
+{
+  return (rx_head - rx_tail + MOCK_SERIAL_RX_SIZE) % MOCK_SERIAL_RX_SIZE;
+}
+
+int MockSerial::read(void)
+{
+  uint8_t byte;
+
+  if (rx_head == rx_tail) {
+    return -1;
+  }
+  byte = rx_buffer[rx_tail];
+  rx_tail = (rx_tail + 1) % MOCK_SERIAL_RX_SIZE;
+  return byte;
+}
+
+size_t MockSerial::write(uint8_t byte)
+{
+  if (mock_arduino_tx_hook) {
+    mock_arduino_tx_hook(byte);
+  }
+  return 1;
+}
+
+size_t MockSerial::write(const uint8_t *buffer, size_t size)
+{
+  for (size_t ix = 0; ix < size; ix++) {
+    write(buffer[ix]);
+  }
+  return size;
+}
+
+size_t MockSerial::print(const char *str)
+{
+  return write((const uint8_t *)str, strlen(str));
+}
+
+size_t MockSerial::print(long value, int base)
+{
+  char str[24];
+
+  snprintf(str, sizeof(str), (base == HEX) ? "%lX" : "%ld", value);
+  return print(str);
+}
+
+size_t MockSerial::println(const char *str)
+{
+  return print(str) + println();
+}
+
+size_t MockSerial::println(long value, int base)
+{
+  return print(value, base) + println();
+}
+
+size_t MockSerial::println(void)
+{
+  return print("\r\n");
+}
@@ -0,0 +1,220 @@
+/*
+ * Host build mock of the LUFA device stack (see mock_lufa.h).
+ */
+
+#include <string.h>
+
+#include <LUFA/Drivers/USB/USB.h>
+#include <LUFA/Drivers/Peripheral/Serial.h>
+
+#include "mock_lufa.h"
+
+#define UEINTX_NAKINI   6
+
+mock_endpoint_t mock_endpoints[MOCK_ENDPOINT_NUM];
+volatile uint8_t mock_endpoint_ueintx[MOCK_ENDPOINT_NUM];
+uint8_t mock_endpoint_selected;
+
+const uint8_t *mock_control_out;
+uint16_t mock_control_out_len;
+bool mock_control_stalled;
+
+void (*mock_serial_send_hook)(uint8_t byte);
+uint32_t mock_serial_baud;
+
+USB_Request_Header_t USB_ControlRequest;
+volatile uint8_t USB_DeviceState;
+
+static mock_endpoint_t *selected(void)
+{
+  return &mock_endpoints[mock_endpoint_selected & ENDPOINT_EPNUM_MASK];
+}
+
+/* The bank the firmware writes: the one after the armed banks. */
+static uint8_t write_bank(const mock_endpoint_t *ep)
+{
+  return (uint8_t)((ep->first + ep->armed) % ep->banks);
+}
+
+void mock_endpoints_reset(void)
+{
+  memset(mock_endpoints, 0, sizeof(mock_endpoints));
+  for (int ep = 0; ep < MOCK_ENDPOINT_NUM; ep++) {
+    mock_endpoints[ep].banks = 1;
+  }
+  memset((void *)mock_endpoint_ueintx, 0, sizeof(mock_endpoint_ueintx));
+  mock_endpoint_selected = ENDPOINT_CONTROLEP;
+}
+
+uint8_t mock_endpoint_host_poll(uint8_t ep_num, uint8_t *data)
+{
+  mock_endpoint_t *ep = &mock_endpoints[ep_num & ENDPOINT_EPNUM_MASK];
+  uint8_t len;
+
+  ep->polls++;
+  if (!ep->armed) {
+    mock_endpoint_ueintx[ep_num & ENDPOINT_EPNUM_MASK] |= (1 << UEINTX_NAKINI);
+    return 0;
+  }
+
+  len = ep->len[ep->first];
+  if (data) {
+    memcpy(data, ep->bank[ep->first], len);
+  }
+  ep->len[ep->first] = 0;
+  ep->first = (uint8_t)((ep->first + 1) % ep->banks);
+  ep->armed--;
+  ep->collected++;
+  return len;
+}
+
+/*
+ * Serial.
+ */
+
+void Serial_Init(const uint32_t BaudRate, const bool DoubleSpeed)
+{
+  (void)DoubleSpeed;
+  mock_serial_baud = BaudRate;
+}
+
+void Serial_SendByte(const char DataByte)
+{
+  if (mock_serial_send_hook) {
+    mock_serial_send_hook((uint8_t)DataByte);
+  }
+}
+
+/*
+ * Device stack.
+ */
+
+void USB_Init(void)
+{
+  mock_endpoints_reset();
+  USB_DeviceState = DEVICE_STATE_Unattached;
+}
+
+void USB_USBTask(void)
+{
+}
+
+void USB_Device_EnableSOFEvents(void)
+{
+}
+
+void USB_Device_DisableSOFEvents(void)
+{
+}
+
+/*
+ * Endpoints.
+ */
+
+bool Endpoint_ConfigureEndpoint(const uint8_t Address, const uint8_t Type,
+                                const uint16_t Size, const uint8_t Banks)
+{
+  mock_endpoint_t *ep = &mock_endpoints[Address & ENDPOINT_EPNUM_MASK];
+
+  (void)Type;
+  memset(ep, 0, sizeof(*ep));
+  ep->configured = (Size <= MOCK_ENDPOINT_BANK_SIZE) && (Banks >= 1) &&
+                   (Banks <= MOCK_ENDPOINT_BANKS);
+  ep->banks = ep->configured ? Banks : 1;
+  return ep->configured;
+}
+
+void Endpoint_SelectEndpoint(const uint8_t Address)
+{
+  mock_endpoint_selected = Address & ENDPOINT_EPNUM_MASK;
+}
+
+uint8_t Endpoint_GetCurrentEndpoint(void)
+{
+  return mock_endpoint_selected;
+}
+
+bool Endpoint_IsINReady(void)
+{
+  return selected()->armed < selected()->banks;
+}
+
+bool Endpoint_IsReadWriteAllowed(void)
+{
+  mock_endpoint_t *ep = selected();
+
+  return ep->len[write_bank(ep)] < MOCK_ENDPOINT_BANK_SIZE;
+}
+
+void Endpoint_ClearIN(void)
+{
+  mock_endpoint_t *ep = selected();
+
+  if (ep->armed < ep->banks) {
+    ep->armed++;
+  }
+}
+
+void Endpoint_ClearOUT(void)
+{
+}
+
+void Endpoint_ClearSETUP(void)
+{
+}
+
+void Endpoint_ClearStatusStage(void)
+{
+}
+
+void Endpoint_StallTransaction(void)
+{
+  mock_control_stalled = true;
+}
+
+void Endpoint_Write_8(const uint8_t Data)
+{
+  mock_endpoint_t *ep = selected();
+  uint8_t bank = write_bank(ep);
+
+  if ((ep->armed < ep->banks) && (ep->len[bank] < MOCK_ENDPOINT_BANK_SIZE)) {
+    ep->bank[bank][ep->len[bank]++] = Data;
+  }
+}
+
+void Endpoint_Write_16_LE(const uint16_t Data)
+{
+  Endpoint_Write_8((uint8_t)Data);
+  Endpoint_Write_8((uint8_t)(Data >> 8));
+}
+
+uint8_t Endpoint_Write_Stream_LE(const void* const Buffer, uint16_t Length,
+                                 uint16_t* const BytesProcessed)
+{
+  const uint8_t *data = (const uint8_t *)Buffer;
+
+  while (Length--) {
+    Endpoint_Write_8(*data++);
+  }
+  if (BytesProcessed) {
+    *BytesProcessed = 0;
+  }
+  return 0;
+}
+
+uint8_t Endpoint_Write_Control_Stream_LE(const void* const Buffer,
+                                         uint16_t Length)
+{
+  return Endpoint_Write_Stream_LE(Buffer, Length, NULL);
+}
+
+uint8_t Endpoint_Read_Control_Stream_LE(void* const Buffer, uint16_t Length)
+{
+  uint16_t len = (Length < mock_control_out_len) ? Length : mock_control_out_len;
+
+  memset(Buffer, 0, Length);
+  if (mock_control_out) {
+    memcpy(Buffer, mock_control_out, len);
+  }
+  return 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * Host build mock of the LUFA device stack: endpoint model and hooks.
+ *
+ * Each IN endpoint has the banks it was configured with, one or two.
+ * Writing a report and clearing IN arms the bank being written, and IN
+ * stays ready while another bank is free; the harness then plays the host
+ * with mock_endpoint_host_poll(), which collects the oldest armed bank or,
+ * as the controller would, NAKs the poll and sets NAKINI.
+ *
+ * Only NAKINI is modelled in UEINTX, the one flag the firmware reads and
+ * clears directly; IN readiness is taken from the bank state. The control
+ * endpoint has a single bank.
+ */
+
+#ifndef _MOCK_LUFA_H_
+#define _MOCK_LUFA_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MOCK_ENDPOINT_NUM       8
+#define MOCK_ENDPOINT_BANK_SIZE 64
+#define MOCK_ENDPOINT_BANKS     2
+
+typedef struct mock_endpoint_t_ {
+  bool     configured;
+  uint8_t  banks;                           /* Configured, 1 or 2 */
+  uint8_t  armed;                           /* Banks written and cleared */
+  uint8_t  first;                           /* Oldest armed bank */
+  uint8_t  len[MOCK_ENDPOINT_BANKS];        /* Bytes in each bank */
+  uint8_t  bank[MOCK_ENDPOINT_BANKS][MOCK_ENDPOINT_BANK_SIZE];
+  uint32_t polls;                           /* Host polls */
+  uint32_t collected;                       /* Polls that collected data */
+} mock_endpoint_t;
+
+extern mock_endpoint_t mock_endpoints[MOCK_ENDPOINT_NUM];
+extern volatile uint8_t mock_endpoint_ueintx[MOCK_ENDPOINT_NUM];
+extern uint8_t mock_endpoint_selected;
+
+/*
+ * Play the host polling an IN endpoint. Returns the number of bytes
+ * collected, copied to data if it is not NULL, or 0 for a NAK.
+ */
+uint8_t mock_endpoint_host_poll(uint8_t ep_num, uint8_t *data);
+
+/*
+ * Control transfers. The data stage of an OUT request is read from
+ * mock_control_out, which the harness points at the data to send, and
+ * a stall sets mock_control_stalled. IN data is written to the control
+ * endpoint's bank.
+ */
+extern const uint8_t *mock_control_out;
+extern uint16_t mock_control_out_len;
+extern bool mock_control_stalled;
+
+/* Reset all endpoints to their power-on state. */
+void mock_endpoints_reset(void);
+
+/*
+ * Bytes sent with Serial_SendByte() go to this hook, when it is set. The
+ * rate of the last Serial_Init() is kept in mock_serial_baud.
+ */
+extern void (*mock_serial_send_hook)(uint8_t byte);
+extern uint32_t mock_serial_baud;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MOCK_LUFA_H_ */
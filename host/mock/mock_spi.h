@@ -0,0 +1,103 @@
+/*
+ * Host build mock of the Mega 2560's SPI port, with a chain of 74HC165
+ * shift registers on it (see shift_scan.h).
+ *
+ * The chain's parallel inputs are held in mock_shift_chain.inputs, first
+ * register (the one on MISO) first, with a set bit for a high input.
+ * Driving the load line (PB0) low latches them. Each byte then written to
+ * SPDR clocks the next register's contents into SPDR; past the end of the
+ * chain, the last register's SER input shifts in ones. Transfers complete
+ * at once, so SPIF always reads as set.
+ *
+ * PORTB, SPSR and SPDR need side effects, so they are small classes; this
+ * file is C++ only, like the sketch.
+ */
+
+#ifndef _MOCK_SPI_H_
+#define _MOCK_SPI_H_
+
+#ifndef __cplusplus
+#error "The SPI mock is C++ only"
+#endif
+
+#include <stdint.h>
+#include <string.h>
+
+#define MOCK_SHIFT_CHAIN_MAX    16
+
+typedef struct mock_shift_chain_t_ {
+  uint8_t inputs[MOCK_SHIFT_CHAIN_MAX];   /* Parallel inputs */
+  uint8_t latched[MOCK_SHIFT_CHAIN_MAX];  /* Contents of the registers */
+  uint8_t next;                           /* Next register to shift out */
+  uint32_t loads;
+  uint32_t transfers;
+} mock_shift_chain_t;
+
+static mock_shift_chain_t mock_shift_chain;
+
+class MockPortB {
+public:
+  MockPortB &operator=(uint8_t v) {
+    value = v;
+    if (!(v & (1 << 0))) {
+      memcpy(mock_shift_chain.latched, mock_shift_chain.inputs,
+             sizeof(mock_shift_chain.latched));
+      mock_shift_chain.next = 0;
+      mock_shift_chain.loads++;
+    }
+    return *this;
+  }
+  MockPortB &operator&=(uint8_t v) { return *this = (uint8_t)(value & v); }
+  MockPortB &operator|=(uint8_t v) { return *this = (uint8_t)(value | v); }
+  operator uint8_t() const { return value; }
+
+private:
+  uint8_t value;
+};
+
+class MockSPSR {
+public:
+  MockSPSR &operator=(uint8_t v) { value = v; return *this; }
+  operator uint8_t() const { return (uint8_t)(value | (1 << 7)); }
+
+private:
+  uint8_t value;
+};
+
+class MockSPDR {
+public:
+  MockSPDR &operator=(uint8_t v) {
+    mock_shift_chain_t *chain = &mock_shift_chain;
+
+    value = (chain->next < MOCK_SHIFT_CHAIN_MAX) ?
+            chain->latched[chain->next++] : 0xFF;
+    chain->transfers++;
+    return *this;
+  }
+  operator uint8_t() const { return value; }
+
+private:
+  uint8_t value;
+};
+
+static MockPortB PORTB __attribute__((unused));
+static MockSPSR SPSR __attribute__((unused));
+static MockSPDR SPDR __attribute__((unused));
+MOCK_REG8(DDRB);
+MOCK_REG8(SPCR);
+
+#define PB0     0
+#define PB1     1
+#define PB2     2
+#define PB3     3
+
+#define SPIE    7
+#define SPE     6
+#define DORD    5
+#define MSTR    4
+#define CPOL    3
+#define CPHA    2
+#define SPIF    7
+#define SPI2X   0
+
+#endif /* _MOCK_SPI_H_ */
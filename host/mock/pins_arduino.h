@@ -0,0 +1,94 @@
+/*
+ * Host build mock of the Arduino Mega's pins_arduino.h (variants/mega).
+ *
+ * The pin tables are copied from the core, not derived from port_scan.h,
+ * so that digitalRead() gives the host bench an independent reference for
+ * the sketch's own pin map.
+ */
+
+#ifndef _MOCK_PINS_ARDUINO_H_
+#define _MOCK_PINS_ARDUINO_H_
+
+#include <stdint.h>
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+#define NUM_DIGITAL_PINS    70
+
+#define NOT_A_PORT  0
+
+#define PA  1
+#define PB  2
+#define PC  3
+#define PD  4
+#define PE  5
+#define PF  6
+#define PG  7
+#define PH  8
+#define PJ  10
+#define PK  11
+#define PL  12
+
+static volatile uint8_t *const port_to_input_PGM[] = {
+  NOT_A_PORT,
+  &PINA,
+  &PINB,
+  &PINC,
+  &PIND,
+  &PINE,
+  &PINF,
+  &PING,
+  &PINH,
+  NOT_A_PORT,
+  &PINJ,
+  &PINK,
+  &PINL,
+};
+
+static const uint8_t PROGMEM digital_pin_to_port_PGM[] = {
+  /* 0 - 9 */
+  PE, PE, PE, PE, PG, PE, PH, PH, PH, PH,
+  /* 10 - 19 */
+  PB, PB, PB, PB, PJ, PJ, PH, PH, PD, PD,
+  /* 20 - 29 */
+  PD, PD, PA, PA, PA, PA, PA, PA, PA, PA,
+  /* 30 - 39 */
+  PC, PC, PC, PC, PC, PC, PC, PC, PD, PG,
+  /* 40 - 49 */
+  PG, PG, PL, PL, PL, PL, PL, PL, PL, PL,
+  /* 50 - 59 */
+  PB, PB, PB, PB, PF, PF, PF, PF, PF, PF,
+  /* 60 - 69 */
+  PF, PF, PK, PK, PK, PK, PK, PK, PK, PK,
+};
+
+static const uint8_t PROGMEM digital_pin_to_bit_mask_PGM[] = {
+  /* 0 - 9: PE0 PE1 PE4 PE5 PG5 PE3 PH3 PH4 PH5 PH6 */
+  _BV(0), _BV(1), _BV(4), _BV(5), _BV(5),
+  _BV(3), _BV(3), _BV(4), _BV(5), _BV(6),
+  /* 10 - 19: PB4 PB5 PB6 PB7 PJ1 PJ0 PH1 PH0 PD3 PD2 */
+  _BV(4), _BV(5), _BV(6), _BV(7), _BV(1),
+  _BV(0), _BV(1), _BV(0), _BV(3), _BV(2),
+  /* 20 - 29: PD1 PD0 PA0 - PA7 */
+  _BV(1), _BV(0), _BV(0), _BV(1), _BV(2),
+  _BV(3), _BV(4), _BV(5), _BV(6), _BV(7),
+  /* 30 - 39: PC7 - PC0 PD7 PG2 */
+  _BV(7), _BV(6), _BV(5), _BV(4), _BV(3),
+  _BV(2), _BV(1), _BV(0), _BV(7), _BV(2),
+  /* 40 - 49: PG1 PG0 PL7 - PL0 */
+  _BV(1), _BV(0), _BV(7), _BV(6), _BV(5),
+  _BV(4), _BV(3), _BV(2), _BV(1), _BV(0),
+  /* 50 - 59: PB3 PB2 PB1 PB0 PF0 - PF5 */
+  _BV(3), _BV(2), _BV(1), _BV(0), _BV(0),
+  _BV(1), _BV(2), _BV(3), _BV(4), _BV(5),
+  /* 60 - 69: PF6 PF7 PK0 - PK7 */
+  _BV(6), _BV(7), _BV(0), _BV(1), _BV(2),
+  _BV(3), _BV(4), _BV(5), _BV(6), _BV(7),
+};
+
+#define digitalPinToPort(P)     (pgm_read_byte(digital_pin_to_port_PGM + (P)))
+#define digitalPinToBitMask(P)  (pgm_read_byte(digital_pin_to_bit_mask_PGM + (P)))
+#define portInputRegister(P)    (port_to_input_PGM[(P)])
+
+#endif /* _MOCK_PINS_ARDUINO_H_ */
@@ -0,0 +1,10 @@
+/* Host build mock of <util/atomic.h>: the host harness is single threaded. */
+
+#ifndef _MOCK_UTIL_ATOMIC_H_
+#define _MOCK_UTIL_ATOMIC_H_
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+#define ATOMIC_BLOCK(type)  for (int mock_atomic_ = 1; mock_atomic_; mock_atomic_ = 0)
+
+#endif /* _MOCK_UTIL_ATOMIC_H_ */
@@ -0,0 +1,294 @@
+/*
+ * Host build of the Arduino sketch (see harness.h).
+ */
+
+#include <Arduino.h>
+
+#include "../arduino/multiplayer_joystick.ino"
+
+#include "harness.h"
+
+#if ANALOG_AXES
+
+/* Conversions per 1 ms scan period, at 26 us each (see analog_axes.h). */
+#define SK_ADC_CONVERSIONS_PER_TICK 38
+
+static uint16_t sk_analog[ANALOG_CHANNELS];
+
+/* Sticks at rest, as they must be at power-up. */
+static void sk_analog_centre(void)
+{
+  uint8_t ch;
+
+  for (ch = 0; ch < ANALOG_CHANNELS; ch++) {
+    sk_analog[ch] = 512;
+  }
+}
+
+void sk_set_analog(uint8_t player, uint16_t x, uint16_t y)
+{
+  sk_analog[player * AXIS_NUM + AXIS_X] = x;
+  sk_analog[player * AXIS_NUM + AXIS_Y] = y;
+}
+
+/* Complete any conversion in progress on the selected channel. */
+static void sk_adc_convert(void)
+{
+  uint8_t channel = (ADMUX & 0x07) | ((ADCSRB & (1 << MUX5)) ? 0x08 : 0);
+
+  if (!(ADCSRA & (1 << ADSC))) {
+    return;
+  }
+  ADC = (channel < ANALOG_CHANNELS) ? sk_analog[channel] : 0;
+  ADCSRA &= ~(1 << ADSC);
+  if (ADCSRA & (1 << ADIE)) {
+    ADC_vect();
+  }
+}
+
+#else
+
+static void sk_analog_centre(void)
+{
+}
+
+void sk_set_analog(uint8_t player, uint16_t x, uint16_t y)
+{
+}
+
+#endif /* ANALOG_AXES */
+
+#if INPUT_SHIFT_REGISTERS
+
+/*
+ * Player inputs are read from the mock shift-register chain, two registers
+ * per player (see shift_scan.h and mock_spi.h).
+ */
+static_assert(SHIFT_SCAN_BYTES <= MOCK_SHIFT_CHAIN_MAX,
+              "mock shift-register chain too short");
+
+void sk_setup(void)
+{
+  /* Pulled up: every input idle. */
+  memset(mock_shift_chain.inputs, 0xFF, sizeof(mock_shift_chain.inputs));
+  sk_analog_centre();
+  setup();
+}
+
+void sk_set_inputs(uint8_t player, uint16_t inputs)
+{
+  uint8_t *reg = &mock_shift_chain.inputs[player * SHIFT_SCAN_REGS_PER_PLAYER];
+
+  /* Active low; the second register's spare inputs stay high. */
+  reg[0] = (uint8_t)~inputs;
+  reg[1] = (uint8_t)~(inputs >> 8) | 0xF0;
+}
+
+void sk_set_port(uint8_t port, uint8_t pins)
+{
+}
+
+bool sk_read_ports(uint16_t inputs[SK_PLAYER_NUM])
+{
+  return false;
+}
+
+bool sk_digital_read(uint16_t inputs[SK_PLAYER_NUM])
+{
+  return false;
+}
+
+#else
+
+/* Player inputs are read from the PINx registers (see port_scan.h). */
+static volatile uint8_t *const sk_port_pin[PORT_NUM] = {
+  &PINA, &PINB, &PINC, &PIND, &PINE, &PINF, &PING, &PINH, &PINJ, &PINL,
+};
+
+static_assert(PORT_NUM == SK_PORT_NUM, "harness.h does not match the ports");
+
+typedef struct sk_pin_t_ {
+  uint8_t port;
+  uint8_t bit;
+} sk_pin_t;
+
+#define SK_PIN(n)   { MEGA_PIN_##n }
+
+static const sk_pin_t sk_pins[] = {
+  SK_PIN(2), SK_PIN(3), SK_PIN(4), SK_PIN(5),
+  SK_PIN(6), SK_PIN(7), SK_PIN(8), SK_PIN(9),
+  SK_PIN(10), SK_PIN(11), SK_PIN(12), SK_PIN(13),
+  SK_PIN(14), SK_PIN(15), SK_PIN(16), SK_PIN(17),
+  SK_PIN(18), SK_PIN(19), SK_PIN(20), SK_PIN(21),
+  SK_PIN(22), SK_PIN(23), SK_PIN(24), SK_PIN(25),
+  SK_PIN(26), SK_PIN(27), SK_PIN(28), SK_PIN(29),
+  SK_PIN(30), SK_PIN(31), SK_PIN(32), SK_PIN(33),
+  SK_PIN(34), SK_PIN(35), SK_PIN(36), SK_PIN(37),
+  SK_PIN(38), SK_PIN(39), SK_PIN(40), SK_PIN(41),
+  SK_PIN(42), SK_PIN(43), SK_PIN(44), SK_PIN(45),
+  SK_PIN(46), SK_PIN(47), SK_PIN(48), SK_PIN(49),
+  SK_PIN(50), SK_PIN(51), SK_PIN(52), SK_PIN(53),
+  SK_PIN(54), SK_PIN(55), SK_PIN(56), SK_PIN(57),
+  SK_PIN(58), SK_PIN(59), SK_PIN(60), SK_PIN(61),
+};
+
+static_assert(sizeof(sk_pins) / sizeof(sk_pins[0]) ==
+              PORT_SCAN_PLAYER_MAX * PINS_PER_JOYSTICK,
+              "pin table incomplete");
+
+void sk_setup(void)
+{
+  uint8_t port;
+
+  /* Pulled up: every input idle. */
+  for (port = PORT_FIRST; port < PORT_NUM; port++) {
+    *sk_port_pin[port] = 0xFF;
+  }
+  sk_analog_centre();
+  setup();
+}
+
+void sk_set_inputs(uint8_t player, uint16_t inputs)
+{
+  const sk_pin_t *pin = &sk_pins[player * PINS_PER_JOYSTICK];
+  uint8_t ix;
+
+  for (ix = 0; ix < PINS_PER_JOYSTICK; ix++, pin++) {
+    if (inputs & (1 << ix)) {
+      *sk_port_pin[pin->port] &= ~(1 << pin->bit);
+    } else {
+      *sk_port_pin[pin->port] |= (1 << pin->bit);
+    }
+  }
+}
+
+void sk_set_port(uint8_t port, uint8_t pins)
+{
+  *sk_port_pin[port] = pins;
+}
+
+bool sk_read_ports(uint16_t inputs[SK_PLAYER_NUM])
+{
+  port_snapshot_t snap;
+
+  memset(&snap, 0, sizeof(snap));
+  port_snapshot_sample(&snap);
+  port_snapshot_decode(&snap, inputs);
+  return true;
+}
+
+/* The sketch's reads before port snapshots: one pin at a time. */
+bool sk_digital_read(uint16_t inputs[SK_PLAYER_NUM])
+{
+  uint8_t player, ix;
+
+  for (player = 0; player < SK_PLAYER_NUM; player++) {
+    uint8_t pin_base = PIN_FIRST + player * PINS_PER_JOYSTICK;
+
+    inputs[player] = 0;
+    for (ix = 0; ix < PINS_PER_JOYSTICK; ix++) {
+      if (digitalRead(pin_base + ix) == LOW) {
+        inputs[player] |= 1 << ix;
+      }
+    }
+  }
+  return true;
+}
+
+#endif /* INPUT_SHIFT_REGISTERS */
+
+void sk_tick(void)
+{
+#if ANALOG_AXES
+  uint8_t ix;
+
+  for (ix = 0; ix < SK_ADC_CONVERSIONS_PER_TICK; ix++) {
+    sk_adc_convert();
+  }
+#endif
+  TIMER1_COMPA_vect();
+  loop();
+}
+
+bool sk_remap(uint16_t *inputs, bool by_bit)
+{
+#if INPUT_REMAP
+  uint16_t out = 0;
+  uint8_t in;
+
+  if (!by_bit) {
+    *inputs = remap_inputs(*inputs);
+    return true;
+  }
+  for (in = 0; in < REMAP_INPUTS; in++) {
+    if (*inputs & REMAP_BIT(in)) {
+      out |= (*inputs & REMAP_BIT(REMAP_SHIFT)) ? REMAP_LAYER_SHIFT(in) :
+                                                  REMAP_LAYER_BASE(in);
+    }
+  }
+  *inputs = out;
+  return true;
+#else
+  return false;
+#endif
+}
+
+uint16_t sk_autofire_ticks(uint8_t player, uint8_t button)
+{
+#if AUTOFIRE
+  return autofire.periods[player][button] * autofire.report_ticks;
+#else
+  return 0;
+#endif
+}
+
+void sk_settings(sk_settings_t *settings)
+{
+  settings->scan_rate_hz = scan_rate_hz;
+  settings->debounce_samples = debounce.samples;
+  settings->link_rate_target = link_rate_target;
+  settings->delta_mode = link_delta_mode;
+  settings->received = link_settings_received;
+}
+
+void sk_update_joystick_states(void)
+{
+  int if_ix;
+
+  for (if_ix = IF_FIRST; if_ix < IF_NUM; if_ix++) {
+    update_joystick_state(if_ix);
+  }
+}
+
+void sk_state(uint8_t player, uint8_t state[SK_STATE_SIZE])
+{
+  memcpy(state, &joy_state[player], SK_STATE_SIZE);
+}
+
+uint16_t sk_debounced(uint8_t player)
+{
+  return debounce.state[player];
+}
+
+uint8_t sk_link_rate(void)
+{
+  return link_rate;
+}
+
+void sk_set_tx_hook(void (*hook)(uint8_t byte))
+{
+  mock_arduino_tx_hook = hook;
+}
+
+void sk_serial_rx(uint8_t byte)
+{
+  mock_arduino_rx(byte);
+}
+
+static_assert((IF_NUM == SK_PLAYER_NUM) &&
+              (sizeof(joystick_state_t) == SK_STATE_SIZE),
+              "harness.h does not match the sketch");
+
+static_assert((REMAP_PLAYER == JOY_NUM + BUTTON_PLAYER) &&
+              (REMAP_SHIFT == JOY_NUM + BUTTON_SHIFT),
+              "input_remap.h does not match the sketch's buttons");
@@ -0,0 +1,170 @@
+/*
+ * Serial link health monitor.
+ *
+ * Polls the 16U2 firmware's link and report counters with the
+ * VENDOR_REQ_GET_STATS request (see vendor_requests.h) and prints, once
+ * per interval, how many of each happened per second: USART errors by
+ * flag, receive queue overflows, frames, CRC and framing errors, lost
+ * frames, resyncs, and reports sent per endpoint, with those sent only
+ * because of an idle timeout in brackets, followed by the reports dropped
+ * from a full report queue. The last column is how much of
+ * the time the firmware's main loop was awake rather than asleep.
+ *
+ * A steady stream of UART or CRC errors at a fast link rate, that stops
+ * at a slower one, points to the cabling or the clock error of that rate.
+ *
+ * Usage: link_stats [-d vid:pid] [-i interval_ms] [-n count]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <libusb.h>
+
+#include "serial_link.h"
+#include "vendor_requests.h"
+
+/* The firmware's default IDs (see descriptors.c). */
+#define LINK_STATS_VID          0x03EB
+#define LINK_STATS_PID          0x2043
+#define LINK_STATS_INTERVAL_MS  1000
+#define LINK_STATS_TIMEOUT_MS   1000
+
+static int read_stats(libusb_device_handle *dev, Vendor_link_stats_t *stats)
+{
+  int len;
+
+  len = libusb_control_transfer(dev, VENDOR_REQTYPE_IN, VENDOR_REQ_GET_STATS,
+                                0, 0, (unsigned char *)stats, sizeof(*stats),
+                                LINK_STATS_TIMEOUT_MS);
+  if (len < 0) {
+    fprintf(stderr, "link_stats: %s\n", libusb_strerror(len));
+    return -1;
+  }
+  if (len != (int)sizeof(*stats)) {
+    fprintf(stderr, "link_stats: short reply, %d bytes\n", len);
+    return -1;
+  }
+  return 0;
+}
+
+/* Counters wrap at 16 bits; one interval never sees a whole wrap. */
+static double rate(uint16_t now, uint16_t then, double seconds)
+{
+  return (uint16_t)(now - then) / seconds;
+}
+
+static void print_header(const Vendor_link_stats_t *stats)
+{
+  uint8_t ep;
+
+  printf("%9s %7s %7s %7s %7s %8s %7s %7s %7s %7s",
+         "baud", "fe/s", "dor/s", "upe/s", "ovf/s", "frames/s", "crc/s",
+         "cobs/s", "lost/s", "sync/s");
+  for (ep = 0; ep < stats->endpoints; ep++) {
+    printf("   ep%u rpt/s (idle) drop/s", ep + 1);
+  }
+  printf(" %7s\n", "awake%");
+}
+
+static void print_rates(const Vendor_link_stats_t *now,
+                        const Vendor_link_stats_t *then, double seconds)
+{
+  uint32_t baud = (now->link_rate < LINK_RATE_NUM) ?
+                  link_rate_baud[now->link_rate] : 0;
+  uint8_t ep;
+
+  printf("%9lu %7.1f %7.1f %7.1f %7.1f %8.1f %7.1f %7.1f %7.1f %7.1f",
+         (unsigned long)baud,
+         rate(now->uart_frame_errors, then->uart_frame_errors, seconds),
+         rate(now->uart_overruns, then->uart_overruns, seconds),
+         rate(now->uart_parity_errors, then->uart_parity_errors, seconds),
+         rate(now->rx_overflows, then->rx_overflows, seconds),
+         rate(now->frames, then->frames, seconds),
+         rate(now->crc_errors, then->crc_errors, seconds),
+         rate(now->framing_errors, then->framing_errors, seconds),
+         rate(now->lost_frames, then->lost_frames, seconds),
+         rate(now->resyncs, then->resyncs, seconds));
+  for (ep = 0; (ep < now->endpoints) && (ep < VENDOR_STATS_ENDPOINTS); ep++) {
+    printf("   %9.1f (%5.1f) %6.1f",
+           rate(now->reports_sent[ep], then->reports_sent[ep], seconds),
+           rate(now->idle_resends[ep], then->idle_resends[ep], seconds),
+           rate(now->reports_coalesced[ep], then->reports_coalesced[ep],
+                seconds));
+  }
+  printf(" %7.1f\n", now->active_permille / 10.0);
+  fflush(stdout);
+}
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: link_stats [-d vid:pid] [-i interval_ms] "
+                  "[-n count]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv)
+{
+  unsigned int vid = LINK_STATS_VID, pid = LINK_STATS_PID;
+  unsigned long interval_ms = LINK_STATS_INTERVAL_MS;
+  long count = -1;
+  libusb_device_handle *dev;
+  Vendor_link_stats_t now, then;
+  int opt, result = 1;
+
+  while ((opt = getopt(argc, argv, "d:i:n:")) != -1) {
+    switch (opt) {
+    case 'd':
+      if (sscanf(optarg, "%x:%x", &vid, &pid) != 2) {
+        usage();
+      }
+      break;
+    case 'i':
+      interval_ms = strtoul(optarg, NULL, 0);
+      if (interval_ms == 0) {
+        usage();
+      }
+      break;
+    case 'n':
+      count = strtol(optarg, NULL, 0);
+      break;
+    default:
+      usage();
+    }
+  }
+
+  if (libusb_init(NULL) != 0) {
+    fprintf(stderr, "link_stats: cannot initialise libusb\n");
+    return 1;
+  }
+  dev = libusb_open_device_with_vid_pid(NULL, (uint16_t)vid, (uint16_t)pid);
+  if (dev == NULL) {
+    fprintf(stderr, "link_stats: no device %04x:%04x\n", vid, pid);
+    goto out;
+  }
+
+  if (read_stats(dev, &then) != 0) {
+    goto close;
+  }
+  print_header(&then);
+
+  while (count != 0) {
+    usleep(interval_ms * 1000);
+    if (read_stats(dev, &now) != 0) {
+      goto close;
+    }
+    print_rates(&now, &then, interval_ms / 1000.0);
+    then = now;
+    if (count > 0) {
+      count--;
+    }
+  }
+  result = 0;
+
+close:
+  libusb_close(dev);
+out:
+  libusb_exit(NULL);
+  return result;
+}